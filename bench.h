@@ -0,0 +1,62 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Замеры для bench_backends.cpp, общие для всех вариантов. С флагом --bench вариант в самом
+// конце печатает одну строку
+//   bench: setup_ms=... run_ms=... teardown_ms=... matches=... moves=... p50_ns=... p99_ns=... p999_ns=...
+// setup - от старта программы до первого раунда (разделяемая память, семафоры, fork игроков),
+// run - сам турнир, teardown - shutdown() транспорта. Задержка хода - время от запроса хода
+// у игрока до момента, когда судья получил ход.
+
+struct BenchStats {
+    std::chrono::steady_clock::time_point programStart = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point runStart;
+    std::chrono::steady_clock::time_point runEnd;
+    long matches = 0;
+    long moves = 0;
+    std::vector<uint64_t> latencies; // нс, по одной на полученный ход
+};
+
+inline bool benchMode = false;
+inline BenchStats benchStats;
+
+inline int64_t benchNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// перцентиль по уже отсортированным задержкам
+inline unsigned long long benchPercentile(const std::vector<uint64_t>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t idx = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[idx];
+}
+
+// вызывается вариантом после shutdown() транспорта
+inline void benchReport() {
+    if (!benchMode) {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    auto ms = [](auto duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+
+    std::vector<uint64_t>& sorted = benchStats.latencies;
+    std::sort(sorted.begin(), sorted.end());
+
+    printf("bench: setup_ms=%.3f run_ms=%.3f teardown_ms=%.3f matches=%ld moves=%ld p50_ns=%llu p99_ns=%llu p999_ns=%llu\n",
+           ms(benchStats.runStart - benchStats.programStart), ms(benchStats.runEnd - benchStats.runStart),
+           ms(now - benchStats.runEnd), benchStats.matches, benchStats.moves,
+           benchPercentile(sorted, 0.5), benchPercentile(sorted, 0.99), benchPercentile(sorted, 0.999));
+    fflush(stdout);
+}
+
+#endif
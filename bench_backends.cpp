@@ -0,0 +1,278 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <csignal>
+#include <cerrno>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+
+// Сквозной бенчмарк всех вариантов: каждый main_* запускается с одним и тем же --seed на
+// наборе N и с набором режимов. Вариант сам печатает строку "bench: ..." (см. bench.h) с
+// временем подготовки, турнира и очистки и перцентилями задержки хода; переключения
+// контекста берутся из getrusage(RUSAGE_CHILDREN) до и после запуска. Одна строка CSV
+// или один объект JSON на запуск, чтобы результаты разных версий можно было сравнивать.
+
+struct Run {
+    std::string variant;
+    std::string mode;
+    int players;
+    int repeat;
+    std::string status;         // ok, fail, timeout или skipped
+    double wall_ms = 0;
+    std::map<std::string, std::string> bench; // поля строки "bench:"
+    long nvcsw = 0;
+    long nivcsw = 0;
+
+    Run(const std::string& variant, const std::string& mode, int players, int repeat, const std::string& status)
+        : variant(variant), mode(mode), players(players), repeat(repeat), status(status) {}
+};
+
+std::vector<std::string> variants = {"sem", "sem_unnamed", "sysv", "posix_mq", "sysv_mq", "futex", "ring", "coro"};
+std::vector<std::string> modes;
+std::vector<int> playerCounts = {2, 16, 128, 1024, 8192, 65536, 100000};
+std::string binDir = ".";
+std::string seed = "1";
+int repeats = 1;
+int timeoutSec = 300;
+int maxProcs = 4096;     // без --pool каждый игрок - процесс, больше не запускаем
+bool json = false;
+
+std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> parts;
+    std::stringstream stream(s);
+    std::string part;
+    while (std::getline(stream, part, sep)) {
+        if (!part.empty()) {
+            parts.push_back(part);
+        }
+    }
+    return parts;
+}
+
+// "bench: key=value key=value ..." -> поля
+std::map<std::string, std::string> parseBench(const std::string& output) {
+    std::map<std::string, std::string> fields;
+    size_t pos = output.rfind("bench: ");
+    if (pos == std::string::npos) {
+        return fields;
+    }
+    std::string line = output.substr(pos + 7, output.find('\n', pos) - pos - 7);
+    for (const std::string& field : split(line, ' ')) {
+        size_t eq = field.find('=');
+        if (eq != std::string::npos) {
+            fields[field.substr(0, eq)] = field.substr(eq + 1);
+        }
+    }
+    return fields;
+}
+
+Run runOnce(const std::string& variant, const std::string& mode, int players, int repeat) {
+    Run run(variant, mode, players, repeat, "ok");
+
+    std::vector<std::string> args = {binDir + "/main_" + variant, "--players", std::to_string(players),
+                                     "--seed", seed, "--log", "off", "--bench"};
+    for (const std::string& arg : split(mode, ' ')) {
+        args.push_back(arg);
+    }
+
+    int out[2];
+    if (pipe(out) == -1) {
+        perror("pipe");
+        exit(1);
+    }
+
+    struct rusage before;
+    getrusage(RUSAGE_CHILDREN, &before);
+    auto start = std::chrono::steady_clock::now();
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        exit(1);
+    }
+    if (pid == 0) {
+        dup2(out[1], STDOUT_FILENO);
+        close(out[0]);
+        close(out[1]);
+        std::vector<char*> argv;
+        for (std::string& arg : args) {
+            argv.push_back(&arg[0]);
+        }
+        argv.push_back(nullptr);
+        execv(argv[0], argv.data());
+        perror(argv[0]);
+        _exit(127);
+    }
+    close(out[1]);
+
+    // вывод читается до EOF; по таймауту вариант получает SIGINT и сам удаляет свои объекты IPC
+    std::string output;
+    char buf[4096];
+    auto deadline = start + std::chrono::seconds(timeoutSec);
+    bool interrupted = false;
+    for (;;) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        struct pollfd pfd = {out[0], POLLIN, 0};
+        int ready = poll(&pfd, 1, std::max(0, static_cast<int>(left.count())));
+        if (ready == -1 && errno == EINTR) {
+            continue;
+        }
+        if (ready == 0) {
+            if (!interrupted) {
+                kill(pid, SIGINT);
+                interrupted = true;
+                deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+                continue;
+            }
+            kill(pid, SIGKILL);
+            break;
+        }
+        ssize_t bytes = read(out[0], buf, sizeof(buf));
+        if (bytes <= 0) {
+            break;
+        }
+        output.append(buf, bytes);
+    }
+    close(out[0]);
+
+    int status;
+    waitpid(pid, &status, 0);
+    run.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    struct rusage after;
+    getrusage(RUSAGE_CHILDREN, &after);
+    run.nvcsw = after.ru_nvcsw - before.ru_nvcsw;
+    run.nivcsw = after.ru_nivcsw - before.ru_nivcsw;
+
+    run.bench = parseBench(output);
+    if (interrupted) {
+        run.status = "timeout";
+    } else if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || run.bench.empty()) {
+        run.status = "fail";
+    }
+    return run;
+}
+
+const std::vector<std::string> benchFields = {"setup_ms", "run_ms", "teardown_ms", "matches", "moves",
+                                              "p50_ns", "p99_ns", "p999_ns"};
+
+std::string rate(const Run& run, const char* field) {
+    auto count = run.bench.find(field);
+    auto ms = run.bench.find("run_ms");
+    if (count == run.bench.end() || ms == run.bench.end() || atof(ms->second.c_str()) <= 0) {
+        return "";
+    }
+    return std::to_string(static_cast<long>(atof(count->second.c_str()) * 1000 / atof(ms->second.c_str())));
+}
+
+void printHeader() {
+    if (json) {
+        std::cout << "[" << std::endl;
+        return;
+    }
+    std::cout << "variant,mode,players,seed,repeat,status,wall_ms";
+    for (const std::string& field : benchFields) {
+        std::cout << "," << field;
+    }
+    std::cout << ",matches_per_sec,moves_per_sec,nvcsw,nivcsw" << std::endl;
+}
+
+void printRun(const Run& run, bool first) {
+    auto value = [&](const std::string& field) {
+        auto it = run.bench.find(field);
+        return it == run.bench.end() ? std::string() : it->second;
+    };
+
+    if (!json) {
+        std::cout << run.variant << "," << run.mode << "," << run.players << "," << seed << "," << run.repeat
+                  << "," << run.status << "," << run.wall_ms;
+        for (const std::string& field : benchFields) {
+            std::cout << "," << value(field);
+        }
+        std::cout << "," << rate(run, "matches") << "," << rate(run, "moves") << "," << run.nvcsw << ","
+                  << run.nivcsw << std::endl;
+        return;
+    }
+
+    // пустые значения (пропущенный или упавший запуск) в JSON пишутся как null
+    auto number = [](const std::string& s) { return s.empty() ? std::string("null") : s; };
+    std::cout << (first ? "  {" : ",\n  {") << "\"variant\": \"" << run.variant << "\", \"mode\": \"" << run.mode
+              << "\", \"players\": " << run.players << ", \"seed\": " << seed << ", \"repeat\": " << run.repeat
+              << ", \"status\": \"" << run.status << "\", \"wall_ms\": " << run.wall_ms;
+    for (const std::string& field : benchFields) {
+        std::cout << ", \"" << field << "\": " << number(value(field));
+    }
+    std::cout << ", \"matches_per_sec\": " << number(rate(run, "matches")) << ", \"moves_per_sec\": "
+              << number(rate(run, "moves")) << ", \"nvcsw\": " << run.nvcsw << ", \"nivcsw\": " << run.nivcsw
+              << "}" << std::flush;
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--players") == 0 && i + 1 < argc) {
+            playerCounts.clear();
+            for (const std::string& count : split(argv[++i], ',')) {
+                playerCounts.push_back(atoi(count.c_str()));
+            }
+        } else if (strcmp(argv[i], "--variants") == 0 && i + 1 < argc) {
+            variants = split(argv[++i], ',');
+        } else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            modes.push_back(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = argv[++i];
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeats = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) {
+            timeoutSec = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-procs") == 0 && i + 1 < argc) {
+            maxProcs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bin-dir") == 0 && i + 1 < argc) {
+            binDir = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        }
+    }
+
+    // по умолчанию процесс на игрока и пул воркеров с параллельными матчами
+    if (modes.empty()) {
+        modes = {"", "--concurrent --pool"};
+    }
+    if (repeats < 1 || timeoutSec < 1) {
+        std::cerr << "Число повторов и таймаут должны быть положительными" << std::endl;
+        return 1;
+    }
+
+    printHeader();
+    bool first = true;
+    for (int players : playerCounts) {
+        for (const std::string& mode : modes) {
+            for (const std::string& variant : variants) {
+                for (int repeat = 1; repeat <= repeats; repeat++) {
+                    Run run(variant, mode, players, repeat, "skipped");
+                    // у main_coro игроки - корутины одного процесса, ограничение на процессы его не касается
+                    bool pooled = variant == "coro" || mode.find("--pool") != std::string::npos ||
+                                  mode.find("--workers") != std::string::npos;
+                    if (pooled || players <= maxProcs) {
+                        std::cerr << "main_" << variant << " " << mode << " N=" << players << "..." << std::endl;
+                        run = runOnce(variant, mode, players, repeat);
+                    }
+                    printRun(run, first);
+                    first = false;
+                }
+            }
+        }
+    }
+    if (json) {
+        std::cout << "\n]" << std::endl;
+    }
+    return 0;
+}
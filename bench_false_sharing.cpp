@@ -0,0 +1,189 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <string>
+#include <algorithm>
+
+// Микробенчмарк к флагу --padded в main_sem.cpp и main_sysv.cpp: P процессов публикуют ходы
+// в свои ячейки PlayerSlot так же, как publishMove(), сначала при плотной раскладке ячеек
+// (шаг sizeof(PlayerSlot)), потом при раскладке по одной ячейке на кэш-линию.
+// Для каждого процесса считаются промахи L1D через perf_event_open; если счетчики
+// недоступны (виртуалка, perf_event_paranoid), печатается только время на ход.
+
+#define CACHE_LINE 64
+
+// та же ячейка, что и в main_sem.cpp / main_sysv.cpp
+struct PlayerSlot {
+    std::atomic<uint32_t> seq;
+    int move;
+    bool in_game;
+};
+
+// результаты одного процесса, каждый в своей кэш-линии, чтобы не мешать замеру
+struct alignas(CACHE_LINE) ProcResult {
+    uint64_t nanos;
+    uint64_t misses;
+    bool counted;
+};
+
+struct RunResult {
+    double ns_per_move;
+    double misses_per_move;
+    bool counted;
+};
+
+int procs = 0;
+long iters = 10000000;
+
+int openMissCounter() {
+    struct perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_L1D |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+void playerLoop(int id, char* slots, size_t stride, std::atomic<int>* ready, ProcResult* result) {
+    // каждый процесс на своем ядре, иначе линия не переходит между кэшами
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(id % cpus, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+
+    PlayerSlot& slot = *reinterpret_cast<PlayerSlot*>(slots + id * stride);
+    int fd = openMissCounter();
+
+    // стартуем одновременно, чтобы процессы действительно писали параллельно
+    ready->fetch_add(1);
+    while (ready->load() < procs) {
+        sched_yield();
+    }
+
+    if (fd != -1) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    for (long i = 0; i < iters; i++) {
+        if (!slot.in_game) {
+            break;
+        }
+        slot.move = i % 3;
+        slot.seq.store(slot.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    auto finish = std::chrono::steady_clock::now();
+    result->nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+    result->counted = false;
+    if (fd != -1) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        result->counted = read(fd, &result->misses, sizeof(result->misses)) == sizeof(result->misses);
+        close(fd);
+    }
+    exit(0);
+}
+
+RunResult run(size_t stride) {
+    size_t slotsSize = (procs * stride + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    size_t size = slotsSize + CACHE_LINE + procs * sizeof(ProcResult);
+    char* shm = static_cast<char*>(mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+    if (shm == MAP_FAILED) {
+        perror("mmap");
+        exit(1);
+    }
+
+    char* slots = shm;
+    auto* ready = reinterpret_cast<std::atomic<int>*>(shm + slotsSize);
+    auto* results = reinterpret_cast<ProcResult*>(shm + slotsSize + CACHE_LINE);
+    for (int i = 0; i < procs; i++) {
+        reinterpret_cast<PlayerSlot*>(slots + i * stride)->in_game = true;
+    }
+
+    std::vector<pid_t> pids;
+    for (int i = 0; i < procs; i++) {
+        pid_t pid = fork();
+        if (pid == -1) {
+            perror("fork");
+            exit(1);
+        }
+        if (pid == 0) {
+            playerLoop(i, slots, stride, ready, &results[i]);
+        }
+        pids.push_back(pid);
+    }
+    for (pid_t pid : pids) {
+        waitpid(pid, nullptr, 0);
+    }
+
+    RunResult total{0, 0, true};
+    for (int i = 0; i < procs; i++) {
+        total.ns_per_move += static_cast<double>(results[i].nanos) / iters;
+        total.misses_per_move += static_cast<double>(results[i].misses) / iters;
+        total.counted = total.counted && results[i].counted;
+    }
+    total.ns_per_move /= procs;
+    total.misses_per_move /= procs;
+
+    munmap(shm, size);
+    return total;
+}
+
+void printResult(const std::string& name, size_t stride, const RunResult& r) {
+    std::cout << name << " (шаг " << stride << " байт): " << std::fixed << std::setprecision(2)
+              << r.ns_per_move << " нс/ход, промахов L1D на ход: ";
+    if (r.counted) {
+        std::cout << std::setprecision(4) << r.misses_per_move << std::endl;
+    } else {
+        std::cout << "н/д" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--procs") == 0 && i + 1 < argc) {
+            procs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--iters") == 0 && i + 1 < argc) {
+            iters = atol(argv[++i]);
+        }
+    }
+
+    // по умолчанию по процессу на ядро, но не меньше двух, иначе делить линию не с кем
+    if (procs <= 0) {
+        procs = std::max(2L, sysconf(_SC_NPROCESSORS_ONLN));
+    }
+    if (iters <= 0) {
+        std::cerr << "Число итераций должно быть положительным" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Процессов: " << procs << ", ядер: " << sysconf(_SC_NPROCESSORS_ONLN)
+              << ", ходов на процесс: " << iters << std::endl;
+
+    RunResult dense = run(sizeof(PlayerSlot));
+    printResult("Плотная раскладка", sizeof(PlayerSlot), dense);
+
+    RunResult padded = run(CACHE_LINE);
+    printResult("По ячейке на кэш-линию", CACHE_LINE, padded);
+
+    std::cout << "Ускорение: " << std::setprecision(2) << dense.ns_per_move / padded.ns_per_move << "x" << std::endl;
+    return 0;
+}
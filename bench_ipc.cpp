@@ -0,0 +1,475 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <mqueue.h>
+#include <sys/wait.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/ipc.h>
+#include <sys/sem.h>
+#include <sys/msg.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// Микробенчмарк примитивов, на которых построены варианты: два процесса перекидываются
+// сообщениями без полезной работы, так что видна только цена самого примитива.
+// У каждого примитива два канала: от первого процесса ко второму и обратно.
+//   задержка - пинг-понг по одному сообщению, p50 и p99 времени полного круга
+//   пропускная способность - первый процесс шлет пачку из W сообщений, второй принимает
+//                            их и подтверждает пачку одним ответом
+// Оба замера делаются, когда процессы закреплены на одном ядре (каждый круг - переключение
+// контекста) и на разных ядрах (пробуждение через IPI), если ядер больше одного.
+
+long iters = 100000;
+int batch = 64;
+
+// канал 0 - от первого процесса ко второму, канал 1 - обратно. Объекты создаются до fork
+struct Primitive {
+    virtual ~Primitive() {}
+    virtual const char* name() = 0;
+    virtual void open() = 0;
+    virtual void post(int channel) = 0;
+    virtual void wait(int channel) = 0;
+    virtual void close() = 0;
+};
+
+// разделяемая память, общая для обоих процессов
+template <typename T>
+T* sharedArray(int count) {
+    void* mem = mmap(nullptr, count * sizeof(T), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        perror("mmap");
+        exit(1);
+    }
+    return static_cast<T*>(mem);
+}
+
+// именованные семафоры, как в main_sem.cpp
+struct NamedSem : Primitive {
+    sem_t* sems[2];
+    const char* names[2] = {"/bench_ipc_0", "/bench_ipc_1"};
+
+    const char* name() override { return "sem_open"; }
+
+    void open() override {
+        for (int i = 0; i < 2; i++) {
+            sem_unlink(names[i]);
+            sems[i] = sem_open(names[i], O_CREAT | O_EXCL, 0666, 0);
+            if (sems[i] == SEM_FAILED) {
+                perror("sem_open");
+                exit(1);
+            }
+        }
+    }
+
+    void post(int channel) override { sem_post(sems[channel]); }
+    void wait(int channel) override { while (sem_wait(sems[channel]) == -1 && errno == EINTR) {} }
+
+    void close() override {
+        for (int i = 0; i < 2; i++) {
+            sem_close(sems[i]);
+            sem_unlink(names[i]);
+        }
+    }
+};
+
+// неименованные семафоры в общей памяти, как в main_sem_unnamed.cpp
+struct UnnamedSem : Primitive {
+    sem_t* sems;
+
+    const char* name() override { return "sem_t in shm"; }
+
+    void open() override {
+        sems = sharedArray<sem_t>(2);
+        for (int i = 0; i < 2; i++) {
+            if (sem_init(&sems[i], 1, 0) == -1) {
+                perror("sem_init");
+                exit(1);
+            }
+        }
+    }
+
+    void post(int channel) override { sem_post(&sems[channel]); }
+    void wait(int channel) override { while (sem_wait(&sems[channel]) == -1 && errno == EINTR) {} }
+
+    void close() override {
+        sem_destroy(&sems[0]);
+        sem_destroy(&sems[1]);
+        munmap(sems, 2 * sizeof(sem_t));
+    }
+};
+
+// семафоры System V через те же обертки, что sem_wait_sysv / sem_post_sysv в main_sysv.cpp
+struct SysvSem : Primitive {
+    int semid = -1;
+
+    const char* name() override { return "semop"; }
+
+    void open() override {
+        semid = semget(IPC_PRIVATE, 2, IPC_CREAT | 0666);
+        if (semid == -1) {
+            perror("semget");
+            exit(1);
+        }
+    }
+
+    void semop1(int channel, short op) {
+        struct sembuf arg{
+            .sem_num = static_cast<unsigned short>(channel),
+            .sem_op = op,
+            .sem_flg = 0
+        };
+        while (semop(semid, &arg, 1) == -1) {
+            if (errno != EINTR) {
+                perror("semop");
+                exit(1);
+            }
+        }
+    }
+
+    void post(int channel) override { semop1(channel, 1); }
+    void wait(int channel) override { semop1(channel, -1); }
+    void close() override { semctl(semid, 0, IPC_RMID); }
+};
+
+// одна очередь System V, канал выбирается через mtype, как шарды в main_sysv_mq.cpp
+struct SysvMsg : Primitive {
+    struct Msg {
+        long mtype;
+        int value;
+    };
+    int msqid = -1;
+
+    const char* name() override { return "msgsnd/msgrcv"; }
+
+    void open() override {
+        msqid = msgget(IPC_PRIVATE, IPC_CREAT | 0666);
+        if (msqid == -1) {
+            perror("msgget");
+            exit(1);
+        }
+    }
+
+    void post(int channel) override {
+        Msg msg{channel + 1, 0};
+        while (msgsnd(msqid, &msg, sizeof(msg) - sizeof(long), 0) == -1) {
+            if (errno != EINTR) {
+                perror("msgsnd");
+                exit(1);
+            }
+        }
+    }
+
+    void wait(int channel) override {
+        Msg msg;
+        while (msgrcv(msqid, &msg, sizeof(msg) - sizeof(long), channel + 1, 0) == -1) {
+            if (errno != EINTR) {
+                perror("msgrcv");
+                exit(1);
+            }
+        }
+    }
+
+    void close() override { msgctl(msqid, IPC_RMID, nullptr); }
+};
+
+// две очереди POSIX, как в main_posix_mq.cpp
+struct PosixMq : Primitive {
+    mqd_t queues[2];
+    const char* names[2] = {"/bench_ipc_mq0", "/bench_ipc_mq1"};
+
+    const char* name() override { return "mq_send/mq_receive"; }
+
+    void open() override {
+        struct mq_attr attr{};
+        attr.mq_maxmsg = 10;
+        attr.mq_msgsize = sizeof(int);
+        for (int i = 0; i < 2; i++) {
+            mq_unlink(names[i]);
+            queues[i] = mq_open(names[i], O_CREAT | O_EXCL | O_RDWR, 0666, &attr);
+            if (queues[i] == (mqd_t) -1) {
+                perror("mq_open");
+                exit(1);
+            }
+        }
+    }
+
+    void post(int channel) override {
+        int value = 0;
+        while (mq_send(queues[channel], reinterpret_cast<char*>(&value), sizeof(value), 0) == -1) {
+            if (errno != EINTR) {
+                perror("mq_send");
+                exit(1);
+            }
+        }
+    }
+
+    void wait(int channel) override {
+        int value;
+        while (mq_receive(queues[channel], reinterpret_cast<char*>(&value), sizeof(value), nullptr) == -1) {
+            if (errno != EINTR) {
+                perror("mq_receive");
+                exit(1);
+            }
+        }
+    }
+
+    void close() override {
+        for (int i = 0; i < 2; i++) {
+            mq_close(queues[i]);
+            mq_unlink(names[i]);
+        }
+    }
+};
+
+// futex по схеме main_futex.cpp: value растет на каждое сообщение, а будящий уходит в ядро,
+// только если получатель выставил sleeping
+struct Futex : Primitive {
+    struct FutexWord {
+        std::atomic<uint32_t> value;
+        std::atomic<uint32_t> sleeping;
+    };
+    FutexWord* words;
+    uint32_t seen[2] = {0, 0}; // сколько сообщений канала уже принято, у каждого процесса свое
+
+    const char* name() override { return "futex"; }
+
+    void open() override {
+        words = sharedArray<FutexWord>(2);
+        seen[0] = seen[1] = 0;
+    }
+
+    static long futex(std::atomic<uint32_t>* word, int op, uint32_t val) {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), op, val, nullptr, nullptr, 0);
+    }
+
+    void post(int channel) override {
+        FutexWord& word = words[channel];
+        word.value.fetch_add(1);
+        if (word.sleeping.load()) {
+            futex(&word.value, FUTEX_WAKE, INT_MAX);
+        }
+    }
+
+    void wait(int channel) override {
+        FutexWord& word = words[channel];
+        while (word.value.load(std::memory_order_acquire) == seen[channel]) {
+            word.sleeping.store(1);
+            if (word.value.load() == seen[channel]) {
+                futex(&word.value, FUTEX_WAIT, seen[channel]);
+            }
+            word.sleeping.store(0);
+        }
+        seen[channel]++;
+    }
+
+    void close() override { munmap(words, 2 * sizeof(FutexWord)); }
+};
+
+// базовая линия: канал ядра без общей памяти, по байту на сообщение
+struct Pipe : Primitive {
+    int fds[2][2];
+
+    const char* name() override { return "pipe"; }
+
+    void open() override {
+        for (int i = 0; i < 2; i++) {
+            if (pipe(fds[i]) == -1) {
+                perror("pipe");
+                exit(1);
+            }
+        }
+    }
+
+    void post(int channel) override {
+        char byte = 0;
+        while (write(fds[channel][1], &byte, 1) != 1) {}
+    }
+
+    void wait(int channel) override {
+        char byte;
+        while (read(fds[channel][0], &byte, 1) != 1) {}
+    }
+
+    void close() override {
+        for (int i = 0; i < 2; i++) {
+            ::close(fds[i][0]);
+            ::close(fds[i][1]);
+        }
+    }
+};
+
+// eventfd в режиме семафора: каждое чтение забирает ровно одно сообщение
+struct EventFd : Primitive {
+    int fds[2];
+
+    const char* name() override { return "eventfd"; }
+
+    void open() override {
+        for (int i = 0; i < 2; i++) {
+            fds[i] = eventfd(0, EFD_SEMAPHORE);
+            if (fds[i] == -1) {
+                perror("eventfd");
+                exit(1);
+            }
+        }
+    }
+
+    void post(int channel) override {
+        uint64_t one = 1;
+        while (write(fds[channel], &one, sizeof(one)) != sizeof(one)) {}
+    }
+
+    void wait(int channel) override {
+        uint64_t value;
+        while (read(fds[channel], &value, sizeof(value)) != sizeof(value)) {}
+    }
+
+    void close() override {
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+};
+
+void pin(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
+        perror("sched_setaffinity");
+        exit(1);
+    }
+}
+
+// второй процесс: принимает пачки по perBatch сообщений и отвечает на каждую одним сообщением
+pid_t startEcho(Primitive& primitive, int cpu, long rounds, int perBatch) {
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        exit(1);
+    }
+    if (pid == 0) {
+        pin(cpu);
+        for (long r = 0; r < rounds; r++) {
+            for (int i = 0; i < perBatch; i++) {
+                primitive.wait(0);
+            }
+            primitive.post(1);
+        }
+        _exit(0);
+    }
+    return pid;
+}
+
+struct Result {
+    double p50_ns;
+    double p99_ns;
+    double messages_per_sec;
+};
+
+Result run(Primitive& primitive, int cpu1, int cpu2) {
+    Result result{};
+    pin(cpu1);
+
+    // задержка: каждый круг - одно сообщение туда и одно обратно
+    primitive.open();
+    pid_t pid = startEcho(primitive, cpu2, iters, 1);
+    std::vector<uint32_t> rtt(iters);
+    for (long i = 0; i < iters; i++) {
+        auto start = std::chrono::steady_clock::now();
+        primitive.post(0);
+        primitive.wait(1);
+        rtt[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+    waitpid(pid, nullptr, 0);
+    primitive.close();
+
+    std::sort(rtt.begin(), rtt.end());
+    result.p50_ns = rtt[iters / 2];
+    result.p99_ns = rtt[iters * 99 / 100];
+
+    // пропускная способность: пачка сообщений на одно подтверждение
+    long rounds = std::max(1L, iters / batch);
+    primitive.open();
+    pid = startEcho(primitive, cpu2, rounds, batch);
+    auto start = std::chrono::steady_clock::now();
+    for (long r = 0; r < rounds; r++) {
+        for (int i = 0; i < batch; i++) {
+            primitive.post(0);
+        }
+        primitive.wait(1);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    waitpid(pid, nullptr, 0);
+    primitive.close();
+
+    result.messages_per_sec = rounds * batch / seconds;
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    std::string only;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iters") == 0 && i + 1 < argc) {
+            iters = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--only") == 0 && i + 1 < argc) {
+            only = argv[++i];
+        }
+    }
+
+    if (iters <= 0 || batch <= 0) {
+        std::cerr << "Число итераций и размер пачки должны быть положительными" << std::endl;
+        return 1;
+    }
+
+    NamedSem namedSem;
+    UnnamedSem unnamedSem;
+    SysvSem sysvSem;
+    SysvMsg sysvMsg;
+    PosixMq posixMq;
+    Futex futex;
+    Pipe pipeBaseline;
+    EventFd eventFd;
+    std::vector<Primitive*> primitives = {&namedSem, &unnamedSem, &sysvSem, &sysvMsg, &posixMq, &futex, &pipeBaseline, &eventFd};
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    std::cout << "Кругов пинг-понга: " << iters << ", сообщений в пачке: " << batch << ", ядер: " << cpus << std::endl;
+    std::cout << "Задержка - p50/p99 полного круга в нс, пропускная способность - сообщений в секунду" << std::endl;
+    std::cout << std::endl;
+    std::cout << std::left << std::setw(20) << "primitive" << std::right
+              << std::setw(10) << "1cpu p50" << std::setw(10) << "1cpu p99" << std::setw(12) << "1cpu msg/s"
+              << std::setw(10) << "2cpu p50" << std::setw(10) << "2cpu p99" << std::setw(12) << "2cpu msg/s" << std::endl;
+
+    for (Primitive* primitive : primitives) {
+        if (!only.empty() && only != primitive->name()) {
+            continue;
+        }
+
+        std::cout << std::left << std::setw(20) << primitive->name() << std::right << std::fixed << std::setprecision(0);
+        Result same = run(*primitive, 0, 0);
+        std::cout << std::setw(10) << same.p50_ns << std::setw(10) << same.p99_ns << std::setw(12) << same.messages_per_sec;
+        if (cpus > 1) {
+            Result cross = run(*primitive, 0, 1);
+            std::cout << std::setw(10) << cross.p50_ns << std::setw(10) << cross.p99_ns << std::setw(12) << cross.messages_per_sec;
+        } else {
+            std::cout << std::setw(10) << "-" << std::setw(10) << "-" << std::setw(12) << "-";
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// Ожидание на futex, общее для main_futex.cpp, main_ring.cpp и tourserver.cpp.
+// Слово FutexWord: value только растет, каждый рост - новое событие (запрос хода, готовый ход).
+// sleeping выставляет ожидающий перед тем как уснуть, чтобы будящий уходил в ядро только когда
+// это нужно. Оба поля меняются seq_cst-операциями: ожидающий пишет sleeping и читает value,
+// будящий пишет value и читает sleeping, поэтому хотя бы один из них видит запись другого.
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "атомики в разделяемой памяти должны быть lock-free");
+
+struct FutexWord {
+    std::atomic<uint32_t> value;
+    std::atomic<uint32_t> sleeping;
+};
+
+// FUTEX_PRIVATE_FLAG можно ставить, только если все участники - потоки одного процесса
+// (main_futex --threads). Иначе слово лежит в памяти, общей для нескольких процессов,
+// и ядро должно искать его по физической странице
+inline bool futexPrivate = false;
+
+inline int futex(std::atomic<uint32_t>* word, int op, uint32_t val) {
+    if (futexPrivate) {
+        op |= FUTEX_PRIVATE_FLAG;
+    }
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), op, val, nullptr, nullptr, 0);
+}
+
+// засыпает, пока word.value равно expected. Если значение уже изменилось, ядро сразу вернет EAGAIN
+inline void futexWait(FutexWord& word, uint32_t expected) {
+    word.sleeping.store(1);
+    if (word.value.load() == expected) {
+        if (futex(&word.value, FUTEX_WAIT, expected) == -1 && errno != EAGAIN && errno != EINTR) {
+            perror("futex wait");
+            exit(1);
+        }
+    }
+    word.sleeping.store(0);
+}
+
+// публикует новое событие и будит ожидающего, только если он действительно спит
+inline void futexBump(FutexWord& word) {
+    word.value.fetch_add(1);
+    if (word.sleeping.load()) {
+        futex(&word.value, FUTEX_WAKE, INT_MAX);
+    }
+}
+
+// ждет следующего события после seen и возвращает новое значение слова
+inline uint32_t waitForEvent(FutexWord& word, uint32_t seen) {
+    uint32_t value;
+    while ((value = word.value.load(std::memory_order_acquire)) == seen) {
+        futexWait(word, seen);
+    }
+    return value;
+}
+
+#endif
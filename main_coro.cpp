@@ -0,0 +1,180 @@
+#include <iostream>
+#include <vector>
+#include <coroutine>
+#include <exception>
+#include <cstring>
+#include <cstdlib>
+#include <signal.h>
+
+#include "tournament.h"
+#include "rng.h"
+
+// Все игроки - корутины C++20 в одном процессе и одном потоке. Корутина игрока хранит свой поток
+// случайных чисел в кадре и засыпает на "жду своего хода"; судья вместо sem_post кладет номер
+// игрока в очередь, а вместо sem_wait возобновляет следующую корутину из очереди. Ни системных
+// вызовов, ни переключений контекста, поэтому сетка на миллион игроков играется за секунды.
+// Движок турнира тот же, что у остальных вариантов, а ходы игрока зависят только от сида и его
+// номера, поэтому при том же --seed победитель и лог совпадают с вариантами на процессах.
+
+// корутина игрока. Кадр создается при запуске и освобождается сам, когда игрок выбывает
+struct PlayerTask {
+    struct promise_type {
+        PlayerTask get_return_object() {
+            return {std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        // корутина сразу доходит до первого ожидания хода, как процесс игрока после fork
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// ячейка игрока: корутина, сделанный ход и участие в турнире. Массив заменяет TournamentState
+struct PlayerSlot {
+    std::coroutine_handle<> coroutine;
+    int move;
+    bool in_game;
+};
+
+int n;
+bool concurrent = false;
+bool dataflow = false;  // --dataflow: сетка без барьера между раундами
+uint64_t seed = 0;      // сид турнира, без --seed выбирается случайно
+bool seeded = false;
+bool statsEnabled = false; // --stats: живые метрики для tourtop
+bool finished = false;
+
+std::vector<PlayerSlot> slots;
+// очередь игроков, у которых попросили ход; в ней не больше одного запроса на игрока,
+// поэтому хватает кольца длины n
+std::vector<int> ready;
+size_t readyHead = 0;
+size_t readyTail = 0;
+
+PlayerTask playerCoroutine(int id) {
+    PlayerRng gen = playerRng(seed, id - 1);
+    PlayerSlot& slot = slots[id - 1];
+
+    while (true) {
+        int64_t waitStart = tourStats.clock();
+        // ждем своего хода: судья возобновит корутину в collectMove
+        co_await std::suspend_always{};
+
+        if (finished || !slot.in_game) {
+            co_return;
+        }
+
+        tourStats.playerMoved(id - 1, waitStart);
+        slot.move = nextMove(gen);
+    }
+}
+
+// возобновляет корутину выбывшего игрока или победителя, чтобы она завершилась и освободила кадр
+void releasePlayer(int player) {
+    std::coroutine_handle<> coroutine = slots[player].coroutine;
+    if (coroutine) {
+        slots[player].coroutine = nullptr;
+        coroutine.resume();
+    }
+}
+
+void handle_sigint(int sig) {
+    std::cout << "Получен SIGINT, завершаю турнир и очищаю ресурсы..." << std::endl;
+    exit(0);
+}
+
+// транспорт для движка турнира: запрос хода - номер игрока в очереди ready,
+// получение хода - возобновление корутины игрока из начала очереди
+struct CoroTransport : TransportBase<CoroTransport> {
+    void requestMove(int player) {
+        ready[readyTail++ % n] = player;
+    }
+
+    // ходы приходят в том же порядке, в каком судья их просил
+    PlayerMove collectMove() {
+        int player = ready[readyHead++ % n];
+        slots[player].coroutine.resume();
+        return {player, slots[player].move};
+    }
+
+    void onMatchDecided(int winner, int loser) {
+        slots[loser].in_game = false;
+        releasePlayer(loser);
+    }
+
+    // завершает корутины оставшихся игроков; дочерних процессов и ресурсов ядра нет
+    void shutdown() {
+        finished = true;
+        for (int i = 0; i < n; i++) {
+            releasePlayer(i);
+        }
+    }
+};
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--concurrent") == 0) {
+            concurrent = true;
+        } else if (strcmp(argv[i], "--dataflow") == 0) {
+            dataflow = true;
+        } else if (strcmp(argv[i], "--players") == 0 && i + 1 < argc) {
+            n = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+            seeded = true;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            benchMode = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            statsEnabled = true;
+        } else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+            if (!setLogLevel(argv[++i])) {
+                std::cerr << "Уровень лога: off, rounds, matches или moves" << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    struct sigaction sa{};
+    sa.sa_handler = handle_sigint;
+    sa.sa_flags = 0;
+    sigaction(SIGINT, &sa, nullptr);
+
+    if (!seeded) {
+        seed = randomSeed();
+    }
+    if (n == 0) {
+        n = playersFromSeed(seed);
+    }
+    if (n < 2) {
+        std::cerr << "Количество игроков должно быть не меньше 2" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Количество игроков в турнире: " << n << std::endl;
+    std::cout << "Сид турнира: " << seed << std::endl;
+
+    if (statsEnabled) {
+        if (!tourStats.create(n, "main_coro")) {
+            return 1;
+        }
+        std::cout << "Метрики: ./tourtop " << getpid() << std::endl;
+    }
+
+    slots.assign(n, {nullptr, 0, true});
+    ready.resize(n);
+    for (int i = 0; i < n; i++) {
+        slots[i].coroutine = playerCoroutine(i + 1).handle;
+    }
+
+    CoroTransport transport;
+    Tournament<CoroTransport> tournament(transport, n, concurrent, dataflow);
+    tournament.run();
+
+    transport.shutdown();
+    benchReport();
+
+    return 0;
+}
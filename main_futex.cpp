@@ -0,0 +1,448 @@
+#include <iostream>
+#include <vector>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <cstring>
+#include <cmath>
+#include <climits>
+#include <cerrno>
+#include <signal.h>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+
+#include "tournament.h"
+#include "rng.h"
+#include "futex.h"
+
+#define SHM_NAME "/futex_shm"
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "атомики в разделяемой памяти должны быть lock-free");
+static_assert(std::atomic<int>::is_always_lock_free, "атомики в разделяемой памяти должны быть lock-free");
+
+// ячейка игрока: счетчик запросов хода и сам ход
+struct PlayerSlot {
+    FutexWord request;
+    int move;
+};
+
+// заголовок разделяемой памяти, массивы размера n лежат сразу за ним
+struct TournamentState {
+    int tournament_winner;
+    int current_round;
+    int total_players;
+    bool is_finished;
+    int workers;                // размер пула воркеров, 0 - отдельный процесс на каждого игрока
+    int request_capacity;       // длина очереди запросов одного воркера
+    FutexWord moves_posted;     // растет на каждый сделанный ход, на нем спит главный процесс
+    std::atomic<uint32_t> ready_tail;
+    size_t slots_offset;
+    size_t in_game_offset;
+    size_t opponent_offset;
+    size_t ready_offset;        // очередь игроков, уже сделавших ход; -1 - ячейка пуста
+    size_t worker_words_offset; // value у воркера - число отправленных ему запросов
+    size_t requests_offset;     // очереди запросов хода, по request_capacity на воркера
+
+    template <typename T>
+    T* array(size_t offset) {
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(this) + offset);
+    }
+
+    PlayerSlot* slots() { return array<PlayerSlot>(slots_offset); }
+    bool* is_in_game() { return array<bool>(in_game_offset); }
+    int* opponent() { return array<int>(opponent_offset); }
+    std::atomic<int>* ready_players() { return array<std::atomic<int>>(ready_offset); }
+    FutexWord* worker_words() { return array<FutexWord>(worker_words_offset); }
+    int* requests(int worker) { return array<int>(requests_offset) + worker * request_capacity; }
+};
+
+std::vector<pid_t> playerPids;
+std::vector<std::thread> playerThreads;
+int n, shm_fd;
+size_t shmSize;
+TournamentState* tournamentState;
+uint32_t readyHead = 0;
+bool concurrent = false;
+bool dataflow = false;  // --dataflow: сетка без барьера между раундами
+bool pool = false;
+bool threads = false;   // --threads: игроки - потоки главного процесса, состояние в куче вместо shm
+int workers = 0;
+uint64_t seed = 0;      // сид турнира, без --seed выбирается случайно
+bool seeded = false;
+bool statsEnabled = false; // --stats: живые метрики для tourtop
+const char* traceFile = nullptr; // --trace FILE: трасса событий для chrome://tracing
+
+// выделяет место под массив в сегменте и возвращает его смещение
+size_t placeArray(size_t& size, size_t bytes, size_t align) {
+    size = (size + align - 1) / align * align;
+    size_t offset = size;
+    size += bytes;
+    return offset;
+}
+
+// считает смещения массивов для n игроков и пула из workers воркеров, возвращает полный размер сегмента
+size_t layoutState(TournamentState* layout, int n, int workers) {
+    size_t size = sizeof(TournamentState);
+    layout->workers = workers;
+    layout->request_capacity = workers > 0 ? (n + workers - 1) / workers : 0;
+    layout->slots_offset = placeArray(size, n * sizeof(PlayerSlot), alignof(PlayerSlot));
+    layout->ready_offset = placeArray(size, n * sizeof(std::atomic<int>), alignof(std::atomic<int>));
+    layout->worker_words_offset = placeArray(size, workers * sizeof(FutexWord), alignof(FutexWord));
+    layout->opponent_offset = placeArray(size, n * sizeof(int), alignof(int));
+    layout->requests_offset = placeArray(size, workers * layout->request_capacity * sizeof(int), alignof(int));
+    layout->in_game_offset = placeArray(size, n * sizeof(bool), alignof(bool));
+    return size;
+}
+
+// кладет ход игрока в его ячейку и сообщает главному процессу
+void publishMove(TournamentState* tournamentState, int player, int move) {
+    tournamentState->slots()[player].move = move;
+
+    uint32_t pos = tournamentState->ready_tail.fetch_add(1) % tournamentState->total_players;
+    tournamentState->ready_players()[pos].store(player, std::memory_order_release);
+
+    tourTrace.event(TRACE_MOVE, player);
+    futexBump(tournamentState->moves_posted);
+}
+
+void playerProcess(int id, TournamentState* tournamentState) {
+    tourTrace.attach(id, TRACE_PLAYER, id);
+    PlayerRng gen = playerRng(seed, id - 1);
+
+    FutexWord& request = tournamentState->slots()[id - 1].request;
+    uint32_t seen = 0;
+
+    while (true) {
+        int64_t waitStart = tourStats.clock();
+        tourTrace.event(TRACE_WAIT);
+        seen = waitForEvent(request, seen);
+
+        if (tournamentState->is_finished || !tournamentState->is_in_game()[id - 1]) {
+            break;
+        }
+
+        tourStats.playerMoved(id - 1, waitStart);
+        tourTrace.event(TRACE_WAKE, id - 1);
+        publishMove(tournamentState, id - 1, nextMove(gen));
+    }
+}
+
+// воркер пула обслуживает игроков worker, worker + workers, ... из одной точки ожидания
+void workerProcess(int worker, TournamentState* tournamentState) {
+    tourTrace.attach(worker + 1, TRACE_WORKER, worker + 1);
+    // у каждого игрока шарда свой поток случайных чисел, тот же, что и у отдельного процесса игрока
+    std::vector<PlayerRng> gens;
+    for (int player = worker; player < n; player += workers) {
+        gens.push_back(playerRng(seed, player));
+    }
+
+    FutexWord& word = tournamentState->worker_words()[worker];
+    int* queue = tournamentState->requests(worker);
+    uint32_t head = 0;
+
+    while (true) {
+        int64_t waitStart = tourStats.clock();
+        tourTrace.event(TRACE_WAIT);
+        uint32_t tail = waitForEvent(word, head);
+
+        if (tournamentState->is_finished) {
+            break;
+        }
+
+        // за одно пробуждение обрабатываются все накопившиеся запросы
+        for (; head != tail; head++) {
+            int player = queue[head % tournamentState->request_capacity];
+            tourStats.playerMoved(player, waitStart);
+            tourTrace.event(TRACE_WAKE, player);
+            publishMove(tournamentState, player, nextMove(gens[player / workers]));
+            waitStart = tourStats.clock(); // остальные запросы пачки уже ждали в очереди
+        }
+    }
+}
+
+// будит все дочерние процессы (или потоки), чтобы они увидели is_finished и завершились
+void releaseProcesses() {
+    tournamentState->is_finished = true;
+    if (pool) {
+        for (int i = 0; i < workers; i++) {
+            futexBump(tournamentState->worker_words()[i]);
+        }
+    } else {
+        for (int i = 0; i < n; i++) {
+            futexBump(tournamentState->slots()[i].request);
+        }
+    }
+}
+
+// дожидается игроков и освобождает состояние турнира: память в куче или сегмент shm
+void releaseState() {
+    for (pid_t pid : playerPids) {
+        waitpid(pid, nullptr, 0);
+    }
+    for (std::thread& thread : playerThreads) {
+        thread.join();
+    }
+    playerThreads.clear();
+
+    if (threads) {
+        free(tournamentState);
+        return;
+    }
+    munmap(tournamentState, shmSize);
+    close(shm_fd);
+    shm_unlink(SHM_NAME);
+}
+
+// с --threads потоки игроков запускаются с заблокированным SIGINT, поэтому обработчик
+// всегда выполняется в главном потоке и может дождаться остальных
+void handle_sigint(int sig) {
+    std::cout << "Получен SIGINT, завершаю турнир и очищаю ресурсы..." << std::endl;
+
+    releaseProcesses();
+    releaseState();
+    exit(0);
+}
+
+// ждет ход любого игрока и возвращает его номер
+int waitForMove() {
+    std::atomic<int>& cell = tournamentState->ready_players()[readyHead % tournamentState->total_players];
+
+    while (true) {
+        // значение счетчика читается до проверки ячейки, иначе можно проспать публикацию
+        uint32_t seen = tournamentState->moves_posted.value.load();
+        int player = cell.load(std::memory_order_acquire);
+        if (player != -1) {
+            cell.store(-1, std::memory_order_relaxed);
+            readyHead++;
+            return player;
+        }
+        futexWait(tournamentState->moves_posted, seen);
+    }
+}
+
+// транспорт для движка турнира: запрос хода - счетчик в ячейке игрока или очередь его воркера,
+// ход - ячейка игрока и номер в очереди ready_players
+struct FutexTransport : TransportBase<FutexTransport> {
+    void requestMove(int player) {
+        if (!pool) {
+            futexBump(tournamentState->slots()[player].request);
+            return;
+        }
+
+        int worker = player % workers;
+        FutexWord& word = tournamentState->worker_words()[worker];
+        uint32_t tail = word.value.load(std::memory_order_relaxed);
+        tournamentState->requests(worker)[tail % tournamentState->request_capacity] = player;
+        futexBump(word);
+    }
+
+    PlayerMove collectMove() {
+        int player = waitForMove();
+        return {player, tournamentState->slots()[player].move};
+    }
+
+    void onRoundStart(int round) {
+        tournamentState->current_round = round;
+    }
+
+    void onMatchStart(const Match& match) {
+        tournamentState->opponent()[match.player1] = match.player2;
+        tournamentState->opponent()[match.player2] = match.player1;
+    }
+
+    // общее состояние турнира меняет только главный процесс, поэтому мьютекс ему не нужен:
+    // игроки читают is_finished и is_in_game уже после того, как увидели новый запрос хода
+    void onMatchDecided(int winner, int loser) {
+        tournamentState->is_in_game()[loser] = false;
+    }
+
+    void onFinish(int winner) {
+        tournamentState->tournament_winner = winner + 1;
+    }
+
+    // будит все дочерние процессы, дожидается их и удаляет разделяемую память
+    void shutdown() {
+        releaseProcesses();
+        releaseState();
+    }
+};
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--concurrent") == 0) {
+            concurrent = true;
+        } else if (strcmp(argv[i], "--dataflow") == 0) {
+            dataflow = true;
+        } else if (strcmp(argv[i], "--players") == 0 && i + 1 < argc) {
+            n = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+            seeded = true;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            benchMode = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            statsEnabled = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+            if (!setLogLevel(argv[++i])) {
+                std::cerr << "Уровень лога: off, rounds, matches или moves" << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            threads = true;
+            futexPrivate = true;
+        } else if (strcmp(argv[i], "--pool") == 0) {
+            pool = true;
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            pool = true;
+            workers = atoi(argv[++i]);
+        }
+    }
+
+    struct sigaction sa{};
+    sa.sa_handler = handle_sigint;
+    sa.sa_flags = 0;
+    sigaction(SIGINT, &sa, nullptr);
+
+    if (!seeded) {
+        seed = randomSeed();
+    }
+    if (n == 0) {
+        n = playersFromSeed(seed);
+    }
+    if (n < 2) {
+        std::cerr << "Количество игроков должно быть не меньше 2" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Количество игроков в турнире: " << n << std::endl;
+    std::cout << "Сид турнира: " << seed << std::endl;
+
+    // сегмент метрик создается до fork, чтобы игроки унаследовали его отображение
+    if (statsEnabled) {
+        if (!tourStats.create(n, "main_futex")) {
+            return 1;
+        }
+        std::cout << "Метрики: ./tourtop " << getpid() << std::endl;
+    }
+
+    if (pool) {
+        // по умолчанию по одному воркеру на ядро
+        if (workers <= 0) {
+            workers = sysconf(_SC_NPROCESSORS_ONLN);
+        }
+        workers = std::max(1, std::min(workers, n));
+        std::cout << "Игроков обслуживает пул из " << workers << " воркеров" << std::endl;
+    }
+
+    // буферы трассы, как и метрики, выделяются до fork: буфер 0 - судья, дальше игроки или воркеры
+    if (traceFile && !tourTrace.create(pool ? workers : n, traceFile)) {
+        return 1;
+    }
+
+    TournamentState layout{};
+    shmSize = layoutState(&layout, n, pool ? workers : 0);
+
+    if (threads) {
+        // потоки видят память друг друга, поэтому состояние просто выделяется в куче
+        tournamentState = (TournamentState*) calloc(1, shmSize);
+        if (tournamentState == nullptr) {
+            perror("calloc");
+            return 1;
+        }
+    } else {
+        shm_fd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0666);
+        if (shm_fd == -1) {
+            perror("shm_open");
+            return 1;
+        }
+
+        if (ftruncate(shm_fd, shmSize) == -1) {
+            perror("ftruncate");
+            return 1;
+        }
+
+        tournamentState = (TournamentState*) mmap(NULL, shmSize,
+                                                   PROT_READ | PROT_WRITE, MAP_SHARED,
+                                                   shm_fd, 0);
+        if (tournamentState == MAP_FAILED) {
+            perror("mmap");
+            return 1;
+        }
+    }
+
+    // нулевые байты - корректное начальное значение для lock-free атомиков,
+    // а заголовок с атомиками не копируется, поэтому смещения считаются прямо в сегменте
+    memset(static_cast<void*>(tournamentState), 0, shmSize);
+    layoutState(tournamentState, n, pool ? workers : 0);
+
+    tournamentState->total_players = n;
+    tournamentState->tournament_winner = -1;
+    tournamentState->is_finished = false;
+    tournamentState->current_round = 1;
+
+    for (int i = 0; i < n; i++) {
+        tournamentState->is_in_game()[i] = true;
+        tournamentState->opponent()[i] = -1;
+        tournamentState->ready_players()[i].store(-1);
+    }
+
+    if (threads) {
+        // маска сигналов наследуется потоками: SIGINT достается только главному потоку
+        sigset_t sigint, old;
+        sigemptyset(&sigint);
+        sigaddset(&sigint, SIGINT);
+        pthread_sigmask(SIG_BLOCK, &sigint, &old);
+
+        for (int i = 0; i < (pool ? workers : n); i++) {
+            try {
+                if (pool) {
+                    playerThreads.emplace_back(workerProcess, i, tournamentState);
+                } else {
+                    playerThreads.emplace_back(playerProcess, i + 1, tournamentState);
+                }
+            } catch (const std::system_error& e) {
+                std::cerr << "std::thread: " << e.what() << std::endl;
+                // уже запущенные потоки надо разбудить и дождаться, иначе деструктор вектора завершит программу
+                releaseProcesses();
+                releaseState();
+                return 1;
+            }
+        }
+
+        pthread_sigmask(SIG_SETMASK, &old, nullptr);
+    } else {
+        for (int i = 0; i < (pool ? workers : n); i++) {
+            pid_t pid = fork();
+            if (pid == -1) {
+                perror("fork");
+                return 1;
+            }
+
+            if (pid == 0) {
+                if (pool) {
+                    workerProcess(i, tournamentState);
+                } else {
+                    playerProcess(i + 1, tournamentState);
+                }
+                exit(0);
+            }
+
+            playerPids.push_back(pid);
+        }
+    }
+
+    FutexTransport transport;
+    Tournament<FutexTransport> tournament(transport, n, concurrent, dataflow);
+    tournament.run();
+
+    transport.shutdown();
+    benchReport();
+
+    return 0;
+}
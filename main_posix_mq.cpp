@@ -1,6 +1,5 @@
 #include <iostream>
 #include <vector>
-#include <random>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <sys/types.h>
@@ -10,8 +9,20 @@
 #include <mqueue.h>
 #include <semaphore.h>
 #include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <fstream>
+#include <deque>
+#include <algorithm>
+#include <cerrno>
+
+#include "tournament.h"
+#include "rng.h"
 
 #define SEM_PLAYER "/player_"
+#define MQUEUE_LIMITS "/proc/sys/fs/mqueue/"
+// примерная цена служебных структур ядра на одно сообщение, для оценки RLIMIT_MSGQUEUE
+#define MQ_MSG_OVERHEAD 96
 
 // структура для передачи сообщений между процессами
 struct MoveMsg {
@@ -23,11 +34,27 @@ std::vector<sem_t*> sem_player_start;
 std::vector<std::string> sem_names;
 mqd_t mqd;
 std::string mq_name;
+std::vector<mqd_t> worker_mqds;          // очереди запросов хода воркерам пула
+std::vector<std::string> worker_mq_names;
+std::vector<std::deque<int>> pendingRequests; // запросы, не поместившиеся в очередь воркера
+std::vector<mqd_t> lane_mqds;            // в режиме --epoll ходы идут по нескольким очередям
+std::vector<std::string> lane_names;
+std::deque<MoveMsg> receivedMoves;       // ходы, уже вычитанные из готовых очередей
+int epfd = -1;
+bool useEpoll = false;
 std::vector<pid_t> playerPids;
 int n;
-std::string moves[3] = {"камень", "ножницы", "бумага"};
-
-void cleanup() {
+bool concurrent = false;
+bool dataflow = false;  // --dataflow: сетка без барьера между раундами
+bool pool = false;
+int workers = 0;
+uint64_t seed = 0;      // сид турнира, без --seed выбирается случайно
+bool seeded = false;
+bool statsEnabled = false; // --stats: живые метрики для tourtop
+const char* traceFile = nullptr; // --trace FILE: трасса событий для chrome://tracing
+
+// будит и дожидается дочерние процессы, удаляет очереди и семафоры
+void releaseResources() {
     for (pid_t pid : playerPids) {
         kill(pid, SIGTERM);
     }
@@ -36,14 +63,30 @@ void cleanup() {
         waitpid(pid, nullptr, 0);
     }
 
-    for (int i = 0; i < n; i++) {
+    for (size_t i = 0; i < sem_player_start.size(); i++) {
         sem_close(sem_player_start[i]);
         sem_unlink(sem_names[i].c_str());
     }
 
+    for (size_t i = 0; i < worker_mqds.size(); i++) {
+        mq_close(worker_mqds[i]);
+        mq_unlink(worker_mq_names[i].c_str());
+    }
+
+    for (size_t i = 0; i < lane_mqds.size(); i++) {
+        mq_close(lane_mqds[i]);
+        mq_unlink(lane_names[i].c_str());
+    }
+    if (epfd != -1) {
+        close(epfd);
+    }
+
     mq_close(mqd);
     mq_unlink(mq_name.c_str());
+}
 
+void cleanup() {
+    releaseResources();
     exit(0);
 }
 
@@ -52,20 +95,44 @@ void handle_sigint(int sig) {
     cleanup();
 }
 
+// открывает очереди ходов в дочернем процессе. У главного процесса очереди открыты с O_NONBLOCK
+// для epoll, а флаг общий для унаследованного дескриптора, поэтому их нужно открыть заново
+std::vector<mqd_t> openLanesForSend() {
+    std::vector<mqd_t> lanes(lane_names.size());
+    for (size_t i = 0; i < lane_names.size(); i++) {
+        lanes[i] = mq_open(lane_names[i].c_str(), O_WRONLY);
+        if (lanes[i] == (mqd_t)-1) {
+            perror("mq_open lane");
+            exit(1);
+        }
+    }
+    return lanes;
+}
+
+// очередь, в которую отправляет ходы игрок: в режиме --epoll игроки разложены по очередям по номеру
+mqd_t moveQueue(const std::vector<mqd_t>& lanes, int player) {
+    return useEpoll ? lanes[player % lanes.size()] : mqd;
+}
+
 void playerProcess(int id) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> distrib(0, 2);
+    tourTrace.attach(id, TRACE_PLAYER, id);
+    PlayerRng gen = playerRng(seed, id - 1);
+    std::vector<mqd_t> lanes = openLanesForSend();
 
     while (true) {
+        int64_t waitStart = tourStats.clock();
+        tourTrace.event(TRACE_WAIT);
         sem_wait(sem_player_start[id - 1]);
+        tourStats.playerMoved(id - 1, waitStart);
+        tourTrace.event(TRACE_WAKE, id - 1);
 
-        int move = distrib(gen);
+        int move = nextMove(gen);
         MoveMsg msg = { 
             id - 1,
             move 
         };
-        if (mq_send(mqd, reinterpret_cast<const char*>(&msg), sizeof(msg), 0) == -1) {
+        tourTrace.event(TRACE_MOVE, id - 1);
+        if (mq_send(moveQueue(lanes, id - 1), reinterpret_cast<const char*>(&msg), sizeof(msg), 0) == -1) {
             perror("mq_send");
             exit(1);
         }
@@ -73,26 +140,276 @@ void playerProcess(int id) {
     exit(0);
 }
 
-int referee(int move1, int move2) {
-    if (move1 == move2) {
-        return 0;
-    } else if (move1 == 0 && move2 == 1 || move1 == 1 && move2 == 2 || move1 == 2 && move2 == 0) {
-        return 1;
+// воркер пула обслуживает игроков worker, worker + workers, ... читая запросы из своей очереди
+void workerProcess(int worker) {
+    tourTrace.attach(worker + 1, TRACE_WORKER, worker + 1);
+    // у каждого игрока шарда свой поток случайных чисел, тот же, что и у отдельного процесса игрока
+    std::vector<PlayerRng> gens;
+    for (int player = worker; player < n; player += workers) {
+        gens.push_back(playerRng(seed, player));
+    }
+    std::vector<mqd_t> lanes = openLanesForSend();
+
+    // у главного процесса очередь открыта с O_NONBLOCK, а флаг общий для унаследованного
+    // дескриптора, поэтому воркер открывает очередь заново в блокирующем режиме
+    mqd_t requests = mq_open(worker_mq_names[worker].c_str(), O_RDONLY);
+    if (requests == (mqd_t)-1) {
+        perror("mq_open worker");
+        exit(1);
+    }
+
+    while (true) {
+        MoveMsg request;
+        int64_t waitStart = tourStats.clock();
+        tourTrace.event(TRACE_WAIT);
+        if (mq_receive(requests, reinterpret_cast<char*>(&request), sizeof(request), nullptr) == -1) {
+            perror("mq_receive");
+            exit(1);
+        }
+        tourStats.playerMoved(request.player_id, waitStart);
+        tourTrace.event(TRACE_WAKE, request.player_id);
+
+        MoveMsg msg = {
+            request.player_id,
+            nextMove(gens[request.player_id / workers])
+        };
+        tourTrace.event(TRACE_MOVE, request.player_id);
+        if (mq_send(moveQueue(lanes, request.player_id), reinterpret_cast<const char*>(&msg), sizeof(msg), 0) == -1) {
+            perror("mq_send");
+            exit(1);
+        }
+    }
+    exit(0);
+}
+
+
+// отправляет накопленные запросы воркерам. Отправка неблокирующая: если главный процесс
+// заблокируется на переполненной очереди воркера, воркеры не смогут отдать ему ходы
+void flushRequests() {
+    for (int w = 0; w < workers; w++) {
+        while (!pendingRequests[w].empty()) {
+            MoveMsg request = {
+                pendingRequests[w].front(),
+                -1
+            };
+            if (mq_send(worker_mqds[w], reinterpret_cast<const char*>(&request), sizeof(request), 0) == -1) {
+                if (errno == EAGAIN) {
+                    break;
+                }
+                perror("mq_send");
+                cleanup();
+            }
+            pendingRequests[w].pop_front();
+        }
+    }
+}
+
+// читает один из лимитов /proc/sys/fs/mqueue, при ошибке возвращает def
+long readMqueueLimit(const char* name, long def) {
+    std::ifstream in(std::string(MQUEUE_LIMITS) + name);
+    long value;
+    if (!(in >> value) || value <= 0) {
+        return def;
+    }
+    return value;
+}
+
+// создает очереди ходов для режима --epoll. Ходов в полете не больше 2 * window, их делим
+// на очереди по msg_max сообщений; число очередей ограничено queues_max (за вычетом очередей
+// воркеров) и RLIMIT_MSGQUEUE, который учитывает суммарный размер всех очередей пользователя
+void openLanes(int inflight, struct mq_attr& attr) {
+    long msgMax = readMqueueLimit("msg_max", 10);
+    long queuesMax = readMqueueLimit("queues_max", 256);
+
+    struct rlimit rl{};
+    long budget = 0;
+    if (getrlimit(RLIMIT_MSGQUEUE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY) {
+        budget = rl.rlim_cur;
+    }
+    long msgCost = attr.mq_msgsize + MQ_MSG_OVERHEAD;
+    // уже занято главной очередью и очередями воркеров
+    long used = 1 + worker_mqds.size();
+
+    long lanes = (inflight + msgMax - 1) / msgMax;
+    lanes = std::min(lanes, queuesMax - used);
+    if (budget > 0) {
+        lanes = std::min(lanes, budget / (msgMax * msgCost) - used);
+    }
+    lanes = std::max(1L, lanes);
+
+    struct mq_attr laneAttr = attr;
+    laneAttr.mq_maxmsg = std::max(1L, std::min(msgMax, (inflight + lanes - 1) / lanes));
+
+    lane_mqds.resize(lanes);
+    lane_names.resize(lanes);
+    for (int i = 0; i < lanes; i++) {
+        lane_names[i] = mq_name + "_l" + std::to_string(i);
+        lane_mqds[i] = mq_open(lane_names[i].c_str(), O_CREAT | O_RDONLY | O_NONBLOCK, 0666, &laneAttr);
+        if (lane_mqds[i] == (mqd_t)-1) {
+            // лимиты общие с другими программами, поэтому при нехватке работаем на уже созданных
+            if ((errno == ENOSPC || errno == EMFILE) && i > 0) {
+                lanes = i;
+                lane_mqds.resize(lanes);
+                lane_names.resize(lanes);
+                break;
+            }
+            perror("mq_open lane");
+            cleanup();
+        }
+    }
+
+    epfd = epoll_create1(0);
+    if (epfd == -1) {
+        perror("epoll_create1");
+        cleanup();
+    }
+    for (int i = 0; i < lanes; i++) {
+        struct epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u32 = i;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, lane_mqds[i], &ev) == -1) {
+            perror("epoll_ctl");
+            cleanup();
+        }
+    }
+
+    std::cout << "Ходы идут через " << lanes << " очередей по " << laneAttr.mq_maxmsg
+              << " сообщений, судья ждет их через epoll" << std::endl;
+}
+
+// возвращает следующий ход. В режиме --epoll судья спит в epoll_wait на всех очередях сразу
+// и за одно пробуждение вычитывает все готовые очереди до конца
+MoveMsg receiveMove() {
+    MoveMsg msg;
+    if (!useEpoll) {
+        if (mq_receive(mqd, reinterpret_cast<char*>(&msg), sizeof(msg), nullptr) == -1) {
+            perror("mq_receive");
+            cleanup();
+        }
+        return msg;
+    }
+
+    std::vector<struct epoll_event> events(lane_mqds.size());
+    while (receivedMoves.empty()) {
+        int ready = epoll_wait(epfd, events.data(), events.size(), -1);
+        if (ready == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            cleanup();
+        }
+        for (int i = 0; i < ready; i++) {
+            mqd_t lane = lane_mqds[events[i].data.u32];
+            while (mq_receive(lane, reinterpret_cast<char*>(&msg), sizeof(msg), nullptr) != -1) {
+                receivedMoves.push_back(msg);
+            }
+            if (errno != EAGAIN) {
+                perror("mq_receive");
+                cleanup();
+            }
+        }
+    }
+    msg = receivedMoves.front();
+    receivedMoves.pop_front();
+    return msg;
+}
+
+// транспорт для движка турнира: запрос хода - семафор игрока или запрос его воркеру,
+// ход - сообщение в очереди
+struct MqTransport : TransportBase<MqTransport> {
+    void requestMove(int player) {
+        if (!pool) {
+            sem_post(sem_player_start[player]);
+            return;
+        }
+        pendingRequests[player % workers].push_back(player);
+    }
+
+    PlayerMove collectMove() {
+        if (pool) {
+            flushRequests();
+        }
+        MoveMsg msg = receiveMove();
+        return {msg.player_id, msg.move};
+    }
+
+    void shutdown() {
+        releaseResources();
     }
-    return 2;
 };
 
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--concurrent") == 0) {
+            concurrent = true;
+        } else if (strcmp(argv[i], "--dataflow") == 0) {
+            dataflow = true;
+        } else if (strcmp(argv[i], "--players") == 0 && i + 1 < argc) {
+            n = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+            seeded = true;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            benchMode = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            statsEnabled = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+            if (!setLogLevel(argv[++i])) {
+                std::cerr << "Уровень лога: off, rounds, matches или moves" << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--pool") == 0) {
+            pool = true;
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            pool = true;
+            workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--epoll") == 0) {
+            useEpoll = true;
+        }
+    }
 
-int main() {
     struct sigaction sa{};
     sa.sa_handler = handle_sigint;
     sigaction(SIGINT, &sa, nullptr);
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> distribPlayers(2, 101);
-    n = distribPlayers(gen);
+    if (!seeded) {
+        seed = randomSeed();
+    }
+    if (n == 0) {
+        n = playersFromSeed(seed);
+    }
+    if (n < 2) {
+        std::cerr << "Количество игроков должно быть не меньше 2" << std::endl;
+        return 1;
+    }
     std::cout << "Количество игроков в турнире: " << n << std::endl;
+    std::cout << "Сид турнира: " << seed << std::endl;
+
+    // сегмент метрик создается до fork, чтобы игроки унаследовали его отображение
+    if (statsEnabled) {
+        if (!tourStats.create(n, "main_posix_mq")) {
+            return 1;
+        }
+        std::cout << "Метрики: ./tourtop " << getpid() << std::endl;
+    }
+
+    if (pool) {
+        // по умолчанию по одному воркеру на ядро
+        if (workers <= 0) {
+            workers = sysconf(_SC_NPROCESSORS_ONLN);
+        }
+        workers = std::max(1, std::min(workers, n));
+        pendingRequests.resize(workers);
+        std::cout << "Игроков обслуживает пул из " << workers << " воркеров" << std::endl;
+    }
+
+    // буферы трассы, как и метрики, выделяются до fork: буфер 0 - судья, дальше игроки или воркеры
+    if (traceFile && !tourTrace.create(pool ? workers : n, traceFile)) {
+        return 1;
+    }
 
     mq_name = "/mq_" + std::to_string(getpid());
     struct mq_attr attr{};
@@ -107,20 +424,36 @@ int main() {
         return 1;
     }
 
-
-
-    sem_player_start.resize(n);
-    sem_names.resize(n);
-    for (int i = 0; i < n; i++) {
-        sem_names[i] = SEM_PLAYER + std::to_string(i);
-        sem_player_start[i] = sem_open(sem_names[i].c_str(), O_CREAT | O_EXCL, 0666, 0);
-        if (sem_player_start[i] == SEM_FAILED) {
-            perror("sem_open sem_player_start");
-            cleanup(); 
+    if (pool) {
+        worker_mqds.resize(workers);
+        worker_mq_names.resize(workers);
+        for (int i = 0; i < workers; i++) {
+            worker_mq_names[i] = mq_name + "_w" + std::to_string(i);
+            worker_mqds[i] = mq_open(worker_mq_names[i].c_str(), O_CREAT | O_WRONLY | O_NONBLOCK, 0666, &attr);
+            if (worker_mqds[i] == (mqd_t)-1) {
+                perror("mq_open worker");
+                cleanup();
+            }
+        }
+    } else {
+        sem_player_start.resize(n);
+        sem_names.resize(n);
+        for (int i = 0; i < n; i++) {
+            sem_names[i] = SEM_PLAYER + std::to_string(i);
+            sem_player_start[i] = sem_open(sem_names[i].c_str(), O_CREAT | O_EXCL, 0666, 0);
+            if (sem_player_start[i] == SEM_FAILED) {
+                perror("sem_open sem_player_start");
+                cleanup(); 
+            }
         }
     }
 
-    for (int i = 0; i < n; i++) {
+    if (useEpoll) {
+        // в конкурентном режиме и в сетке --dataflow в полете ходы всех игроков, иначе двух игроков одного матча
+        openLanes(concurrent || dataflow ? n : 2, attr);
+    }
+
+    for (int i = 0; i < (pool ? workers : n); i++) {
         pid_t pid = fork();
 
         if (pid < 0) {
@@ -132,87 +465,20 @@ int main() {
             // устанавливаю обработчик сигнала SIGINT по умолчанию,
             // чтобы не происходило очистки ресурсов при SIGINT в дочерних процессах
             signal(SIGINT, SIG_DFL);
-            playerProcess(i + 1);
+            if (pool) {
+                workerProcess(i);
+            } else {
+                playerProcess(i + 1);
+            }
         }
         playerPids.push_back(pid);
     }
 
-    std::vector<bool> is_in_game(n, true);
-    std::vector<int> round_winners(n);
-    int winners_count = 0;
-    int tournament_winner = -1;
-
-    int numRounds = static_cast<int>(std::ceil(std::log2(n)));
-    std::vector<int> activeStudents(n);
-    for (int i = 0; i < n; i++) {
-        activeStudents[i] = i;
-    }
-
-    for (int round = 1; round <= numRounds; round++) {
-        std::cout << "\nРаунд " << round << std::endl;
-        winners_count = 0;
-
-        if (activeStudents.size() % 2 == 1) {
-            int idx = activeStudents.back();
-            activeStudents.pop_back();
-            std::cout << "Студент " << idx + 1 << " проходит в следующий раунд" << std::endl;
-            round_winners[winners_count++] = idx;
-        }
+    MqTransport transport;
+    Tournament<MqTransport> tournament(transport, n, concurrent, dataflow);
+    tournament.run();
 
-        int matchCount = activeStudents.size() / 2;
-        for (int m = 0; m < matchCount; m++) {
-            int p1 = activeStudents[2 * m];
-            int p2 = activeStudents[2 * m + 1];
-            std::cout << "Матч между " << p1 + 1 << " и " << p2 + 1 << std::endl;
-
-            sem_post(sem_player_start[p1]);
-            sem_post(sem_player_start[p2]);
-
-            bool decided = false;
-            while (!decided) {
-                MoveMsg msg1, msg2;
-                if (mq_receive(mqd, reinterpret_cast<char*>(&msg1), sizeof(msg1), nullptr) == -1) {
-                    perror("mq_receive");
-                    cleanup();
-                }
-
-                if (mq_receive(mqd, reinterpret_cast<char*>(&msg2), sizeof(msg2), nullptr) == -1) {
-                    perror("mq_receive");
-                    cleanup();
-                }
-
-                int c1 = msg1.move;
-                int c2 = msg2.move;
-
-                std::cout << "   Игрок " << msg1.player_id + 1 << " выбрал " << moves[c1] << std::endl;
-                std::cout << "   Игрок " << msg2.player_id + 1 << " выбрал " << moves[c2] << std::endl;
-
-                int res = referee(c1, c2);
-                if (res == 1) {
-                    std::cout << "  Игрок " << msg1.player_id + 1 << " победил" << std::endl;
-                    round_winners[winners_count++] = p1;
-                    decided = true;
-                } else if (res == 2) {
-                    std::cout << "  Игрок " << msg2.player_id + 1 << " победил" << std::endl;
-                    round_winners[winners_count++] = p2;
-                    decided = true;
-                } else {
-                    std::cout << "  Ничья, матч переигрывается..." << std::endl;
-                    sem_post(sem_player_start[p1]);
-                    sem_post(sem_player_start[p2]);
-                }
-            }
-        }
-
-        activeStudents.clear();
-        for (int i = 0; i < winners_count; i++) activeStudents.push_back(round_winners[i]);
-        if (activeStudents.size() == 1) {
-            tournament_winner = activeStudents[0] + 1;
-            std::cout << "\nТурнир закончен, выиграл игрок под номером: " << tournament_winner << std::endl;
-            break;
-        }
-    }
-
-    cleanup();
+    transport.shutdown();
+    benchReport();
     return 0;
 } 
\ No newline at end of file
@@ -0,0 +1,458 @@
+#include <iostream>
+#include <vector>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <cstring>
+#include <cmath>
+#include <climits>
+#include <cerrno>
+#include <signal.h>
+#include <string>
+#include <atomic>
+#include <deque>
+#include <algorithm>
+
+#include "tournament.h"
+#include "rng.h"
+#include "futex.h"
+
+#define SHM_NAME "/ring_shm"
+#define CACHE_LINE 64
+// у игрока в полете не больше одного хода, поэтому кольцу хватает нескольких записей
+#define RING_CAPACITY 4
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "атомики в разделяемой памяти должны быть lock-free");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "атомики в разделяемой памяти должны быть lock-free");
+
+// та же структура сообщения, что и в main_posix_mq.cpp
+struct MoveMsg {
+    int player_id;
+    int move;
+};
+
+// Кольцо ходов одного игрока: пишет только игрок (или его воркер), читает только главный процесс.
+// tail и head в разных кэш-линиях, чтобы производитель и потребитель не перетягивали одну линию
+struct alignas(CACHE_LINE) MoveRing {
+    FutexWord request;                              // запросы хода от главного процесса
+    alignas(CACHE_LINE) std::atomic<uint32_t> tail; // двигает производитель
+    MoveMsg records[RING_CAPACITY];
+    alignas(CACHE_LINE) std::atomic<uint32_t> head; // двигает потребитель
+};
+
+// заголовок разделяемой памяти, массивы размера n лежат сразу за ним
+struct TournamentState {
+    int tournament_winner;
+    int current_round;
+    int total_players;
+    bool is_finished;
+    int workers;                 // размер пула воркеров, 0 - отдельный процесс на каждого игрока
+    int request_capacity;        // длина очереди запросов одного воркера
+    int ready_words;             // слов в битовой маске готовых колец
+    FutexWord moves_posted;      // звонок главному процессу: растет на каждый сделанный ход
+    size_t rings_offset;
+    size_t ready_bits_offset;    // бит игрока выставлен, если в его кольце есть ходы
+    size_t ready_summary_offset; // бит слова ready_bits выставлен, если в слове есть выставленные биты
+    size_t in_game_offset;
+    size_t worker_words_offset;  // value у воркера - число отправленных ему запросов
+    size_t requests_offset;      // очереди запросов хода, по request_capacity на воркера
+
+    template <typename T>
+    T* array(size_t offset) {
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(this) + offset);
+    }
+
+    MoveRing* rings() { return array<MoveRing>(rings_offset); }
+    std::atomic<uint64_t>* ready_bits() { return array<std::atomic<uint64_t>>(ready_bits_offset); }
+    std::atomic<uint64_t>* ready_summary() { return array<std::atomic<uint64_t>>(ready_summary_offset); }
+    bool* is_in_game() { return array<bool>(in_game_offset); }
+    FutexWord* worker_words() { return array<FutexWord>(worker_words_offset); }
+    int* requests(int worker) { return array<int>(requests_offset) + worker * request_capacity; }
+};
+
+std::vector<pid_t> playerPids;
+int n, shm_fd;
+size_t shmSize;
+TournamentState* tournamentState;
+std::deque<MoveMsg> receivedMoves; // ходы, уже вычитанные из колец
+bool concurrent = false;
+bool dataflow = false;  // --dataflow: сетка без барьера между раундами
+bool pool = false;
+int workers = 0;
+uint64_t seed = 0;      // сид турнира, без --seed выбирается случайно
+bool seeded = false;
+bool statsEnabled = false; // --stats: живые метрики для tourtop
+const char* traceFile = nullptr; // --trace FILE: трасса событий для chrome://tracing
+
+// выделяет место под массив в сегменте и возвращает его смещение
+size_t placeArray(size_t& size, size_t bytes, size_t align) {
+    size = (size + align - 1) / align * align;
+    size_t offset = size;
+    size += bytes;
+    return offset;
+}
+
+// считает смещения массивов для n игроков и пула из workers воркеров, возвращает полный размер сегмента
+size_t layoutState(TournamentState* layout, int n, int workers) {
+    size_t size = sizeof(TournamentState);
+    layout->workers = workers;
+    layout->request_capacity = workers > 0 ? (n + workers - 1) / workers : 0;
+    layout->ready_words = (n + 63) / 64;
+    int summaryWords = (layout->ready_words + 63) / 64;
+    layout->rings_offset = placeArray(size, n * sizeof(MoveRing), alignof(MoveRing));
+    layout->ready_bits_offset = placeArray(size, layout->ready_words * sizeof(uint64_t), CACHE_LINE);
+    layout->ready_summary_offset = placeArray(size, summaryWords * sizeof(uint64_t), CACHE_LINE);
+    layout->worker_words_offset = placeArray(size, workers * sizeof(FutexWord), alignof(FutexWord));
+    layout->requests_offset = placeArray(size, workers * layout->request_capacity * sizeof(int), alignof(int));
+    layout->in_game_offset = placeArray(size, n * sizeof(bool), alignof(bool));
+    return size;
+}
+
+// кладет запись в кольцо. Переполнения в турнире не бывает, но на всякий случай производитель
+// ждет, пока главный процесс освободит место
+void pushMove(MoveRing& ring, const MoveMsg& msg) {
+    uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+    while (tail - ring.head.load(std::memory_order_acquire) == RING_CAPACITY) {
+        sched_yield();
+    }
+    ring.records[tail % RING_CAPACITY] = msg;
+    ring.tail.store(tail + 1, std::memory_order_release);
+}
+
+// кладет ход в кольцо игрока, отмечает кольцо готовым и звонит главному процессу.
+// Сначала выставляется бит игрока, потом бит его слова: главный процесс снимает их в обратном порядке
+void publishMove(TournamentState* tournamentState, int player, int move) {
+    pushMove(tournamentState->rings()[player], {player, move});
+
+    int word = player / 64;
+    tournamentState->ready_bits()[word].fetch_or(1ULL << (player % 64), std::memory_order_release);
+    tournamentState->ready_summary()[word / 64].fetch_or(1ULL << (word % 64), std::memory_order_release);
+
+    tourTrace.event(TRACE_MOVE, player);
+    futexBump(tournamentState->moves_posted);
+}
+
+void playerProcess(int id, TournamentState* tournamentState) {
+    tourTrace.attach(id, TRACE_PLAYER, id);
+    PlayerRng gen = playerRng(seed, id - 1);
+
+    FutexWord& request = tournamentState->rings()[id - 1].request;
+    uint32_t seen = 0;
+
+    while (true) {
+        int64_t waitStart = tourStats.clock();
+        tourTrace.event(TRACE_WAIT);
+        seen = waitForEvent(request, seen);
+
+        if (tournamentState->is_finished || !tournamentState->is_in_game()[id - 1]) {
+            break;
+        }
+
+        tourStats.playerMoved(id - 1, waitStart);
+        tourTrace.event(TRACE_WAKE, id - 1);
+        publishMove(tournamentState, id - 1, nextMove(gen));
+    }
+
+    exit(0);
+}
+
+// воркер пула обслуживает игроков worker, worker + workers, ... из одной точки ожидания.
+// У каждого кольца по-прежнему один производитель - воркер, за которым закреплен игрок
+void workerProcess(int worker, TournamentState* tournamentState) {
+    tourTrace.attach(worker + 1, TRACE_WORKER, worker + 1);
+    // у каждого игрока шарда свой поток случайных чисел, тот же, что и у отдельного процесса игрока
+    std::vector<PlayerRng> gens;
+    for (int player = worker; player < n; player += workers) {
+        gens.push_back(playerRng(seed, player));
+    }
+
+    FutexWord& word = tournamentState->worker_words()[worker];
+    int* queue = tournamentState->requests(worker);
+    uint32_t head = 0;
+
+    while (true) {
+        int64_t waitStart = tourStats.clock();
+        tourTrace.event(TRACE_WAIT);
+        uint32_t tail = waitForEvent(word, head);
+
+        if (tournamentState->is_finished) {
+            break;
+        }
+
+        // за одно пробуждение обрабатываются все накопившиеся запросы
+        for (; head != tail; head++) {
+            int player = queue[head % tournamentState->request_capacity];
+            tourStats.playerMoved(player, waitStart);
+            tourTrace.event(TRACE_WAKE, player);
+            publishMove(tournamentState, player, nextMove(gens[player / workers]));
+            waitStart = tourStats.clock(); // остальные запросы пачки уже ждали в очереди
+        }
+    }
+
+    exit(0);
+}
+
+// будит все дочерние процессы, чтобы они увидели is_finished и завершились
+void releaseProcesses() {
+    tournamentState->is_finished = true;
+    if (pool) {
+        for (int i = 0; i < workers; i++) {
+            futexBump(tournamentState->worker_words()[i]);
+        }
+    } else {
+        for (int i = 0; i < n; i++) {
+            futexBump(tournamentState->rings()[i].request);
+        }
+    }
+}
+
+void handle_sigint(int sig) {
+    std::cout << "Получен SIGINT, завершаю турнир и очищаю ресурсы..." << std::endl;
+
+    releaseProcesses();
+
+    for (pid_t pid : playerPids) {
+        waitpid(pid, nullptr, 0);
+    }
+
+    munmap(tournamentState, shmSize);
+    close(shm_fd);
+    shm_unlink(SHM_NAME);
+    exit(0);
+}
+
+// вычитывает все кольца, отмеченные готовыми. Просматриваются только слова маски,
+// отмеченные в ready_summary, поэтому проход стоит O(N / 4096), а не O(N)
+void drainReadyRings() {
+    std::atomic<uint64_t>* summary = tournamentState->ready_summary();
+    std::atomic<uint64_t>* bits = tournamentState->ready_bits();
+    MoveRing* rings = tournamentState->rings();
+    int summaryWords = (tournamentState->ready_words + 63) / 64;
+
+    for (int s = 0; s < summaryWords; s++) {
+        if (summary[s].load(std::memory_order_relaxed) == 0) {
+            continue;
+        }
+        uint64_t words = summary[s].exchange(0, std::memory_order_acquire);
+        while (words) {
+            int word = s * 64 + __builtin_ctzll(words);
+            words &= words - 1;
+
+            uint64_t mask = bits[word].exchange(0, std::memory_order_acquire);
+            while (mask) {
+                int player = word * 64 + __builtin_ctzll(mask);
+                mask &= mask - 1;
+
+                MoveRing& ring = rings[player];
+                uint32_t head = ring.head.load(std::memory_order_relaxed);
+                uint32_t tail = ring.tail.load(std::memory_order_acquire);
+                for (; head != tail; head++) {
+                    receivedMoves.push_back(ring.records[head % RING_CAPACITY]);
+                }
+                ring.head.store(head, std::memory_order_release);
+            }
+        }
+    }
+}
+
+// возвращает следующий ход. Главный процесс уходит в ядро только когда все кольца пусты
+MoveMsg receiveMove() {
+    while (receivedMoves.empty()) {
+        // значение звонка читается до просмотра колец, иначе можно проспать публикацию
+        uint32_t seen = tournamentState->moves_posted.value.load();
+        drainReadyRings();
+        if (receivedMoves.empty()) {
+            futexWait(tournamentState->moves_posted, seen);
+        }
+    }
+
+    MoveMsg msg = receivedMoves.front();
+    receivedMoves.pop_front();
+    return msg;
+}
+
+// транспорт для движка турнира: запрос хода - счетчик в кольце игрока или очередь его воркера,
+// ход - запись в кольце
+struct RingTransport : TransportBase<RingTransport> {
+    void requestMove(int player) {
+        if (!pool) {
+            futexBump(tournamentState->rings()[player].request);
+            return;
+        }
+
+        int worker = player % workers;
+        FutexWord& word = tournamentState->worker_words()[worker];
+        uint32_t tail = word.value.load(std::memory_order_relaxed);
+        tournamentState->requests(worker)[tail % tournamentState->request_capacity] = player;
+        futexBump(word);
+    }
+
+    PlayerMove collectMove() {
+        MoveMsg msg = receiveMove();
+        return {msg.player_id, msg.move};
+    }
+
+    void onRoundStart(int round) {
+        tournamentState->current_round = round;
+    }
+
+    void onMatchDecided(int winner, int loser) {
+        tournamentState->is_in_game()[loser] = false;
+    }
+
+    void onFinish(int winner) {
+        tournamentState->tournament_winner = winner + 1;
+    }
+
+    // будит все дочерние процессы, дожидается их и удаляет разделяемую память
+    void shutdown() {
+        releaseProcesses();
+
+        for (pid_t pid : playerPids) {
+            waitpid(pid, nullptr, 0);
+        }
+
+        munmap(tournamentState, shmSize);
+        close(shm_fd);
+        shm_unlink(SHM_NAME);
+    }
+};
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--concurrent") == 0) {
+            concurrent = true;
+        } else if (strcmp(argv[i], "--dataflow") == 0) {
+            dataflow = true;
+        } else if (strcmp(argv[i], "--players") == 0 && i + 1 < argc) {
+            n = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+            seeded = true;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            benchMode = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            statsEnabled = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+            if (!setLogLevel(argv[++i])) {
+                std::cerr << "Уровень лога: off, rounds, matches или moves" << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--pool") == 0) {
+            pool = true;
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            pool = true;
+            workers = atoi(argv[++i]);
+        }
+    }
+
+    struct sigaction sa{};
+    sa.sa_handler = handle_sigint;
+    sa.sa_flags = 0;
+    sigaction(SIGINT, &sa, nullptr);
+
+    if (!seeded) {
+        seed = randomSeed();
+    }
+    if (n == 0) {
+        n = playersFromSeed(seed);
+    }
+    if (n < 2) {
+        std::cerr << "Количество игроков должно быть не меньше 2" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Количество игроков в турнире: " << n << std::endl;
+    std::cout << "Сид турнира: " << seed << std::endl;
+
+    // сегмент метрик создается до fork, чтобы игроки унаследовали его отображение
+    if (statsEnabled) {
+        if (!tourStats.create(n, "main_ring")) {
+            return 1;
+        }
+        std::cout << "Метрики: ./tourtop " << getpid() << std::endl;
+    }
+
+    if (pool) {
+        // по умолчанию по одному воркеру на ядро
+        if (workers <= 0) {
+            workers = sysconf(_SC_NPROCESSORS_ONLN);
+        }
+        workers = std::max(1, std::min(workers, n));
+        std::cout << "Игроков обслуживает пул из " << workers << " воркеров" << std::endl;
+    }
+
+    // буферы трассы, как и метрики, выделяются до fork: буфер 0 - судья, дальше игроки или воркеры
+    if (traceFile && !tourTrace.create(pool ? workers : n, traceFile)) {
+        return 1;
+    }
+
+    shm_fd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0666);
+    if (shm_fd == -1) {
+        perror("shm_open");
+        return 1;
+    }
+
+    TournamentState layout{};
+    shmSize = layoutState(&layout, n, pool ? workers : 0);
+
+    if (ftruncate(shm_fd, shmSize) == -1) {
+        perror("ftruncate");
+        return 1;
+    }
+
+    tournamentState = (TournamentState*) mmap(NULL, shmSize,
+                                               PROT_READ | PROT_WRITE, MAP_SHARED,
+                                               shm_fd, 0);
+    if (tournamentState == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    // нулевые байты - корректное начальное значение для lock-free атомиков и пустых колец,
+    // а заголовок с атомиками не копируется, поэтому смещения считаются прямо в сегменте
+    memset(static_cast<void*>(tournamentState), 0, shmSize);
+    layoutState(tournamentState, n, pool ? workers : 0);
+
+    tournamentState->total_players = n;
+    tournamentState->tournament_winner = -1;
+    tournamentState->is_finished = false;
+    tournamentState->current_round = 1;
+
+    for (int i = 0; i < n; i++) {
+        tournamentState->is_in_game()[i] = true;
+    }
+
+    for (int i = 0; i < (pool ? workers : n); i++) {
+        pid_t pid = fork();
+        if (pid == -1) {
+            perror("fork");
+            return 1;
+        }
+
+        if (pid == 0) {
+            if (pool) {
+                workerProcess(i, tournamentState);
+            } else {
+                playerProcess(i + 1, tournamentState);
+            }
+            exit(0);
+        }
+
+        playerPids.push_back(pid);
+    }
+
+    RingTransport transport;
+    Tournament<RingTransport> tournament(transport, n, concurrent, dataflow);
+    tournament.run();
+
+    transport.shutdown();
+    benchReport();
+
+    return 0;
+}
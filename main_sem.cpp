@@ -1,6 +1,5 @@
 #include <iostream>
 #include <vector>
-#include <random>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <sys/types.h>
@@ -11,81 +10,213 @@
 #include <cmath>
 #include <signal.h>
 #include <string>
+#include <atomic>
+#include <cstdint>
+#include <sched.h>
+#include <algorithm>
+
+#include "tournament.h"
+#include "rng.h"
 
 #define SHM_NAME "/main_shm"
 #define MAIN_SEM "/main_sem"
 #define PLAYER_SEM "/player_"
 #define MOVE_MADE_SEM "/move_made"
+#define WORKER_SEM "/worker_"
+
+#define CACHE_LINE 64
+#define MAX_PIPELINE 16 // столько ходов по 2 бита помещается в int ячейки игрока
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "атомики в разделяемой памяти должны быть lock-free");
+static_assert(std::atomic<int>::is_always_lock_free, "атомики в разделяемой памяти должны быть lock-free");
 
+// ячейка хода игрока: пишет в нее только сам игрок (или его воркер), читает только главный процесс.
+// seq растет на каждый опубликованный ход, ход становится виден после release-записи seq.
+// in_game меняет главный процесс, но читает только сам игрок, поэтому он лежит рядом с ходом.
+// С --pipeline K в move упаковано K следующих ходов по 2 бита, первый в младших битах
+struct PlayerSlot {
+    std::atomic<uint32_t> seq;
+    int move;
+    bool in_game;
+};
 
+// заголовок разделяемой памяти, массивы размера n лежат сразу за ним
 struct TournamentState {
-    int players_moves[100];  
-    bool is_in_game[100];            
-    int opponent[100];           
-    int tournament_winner;                   
-    int round_winners[100];       
-    int winners_count;         
-    int current_round;             
-    int total_players;            
-    bool is_finished;          
+    int tournament_winner;
+    int current_round;
+    int total_players;
+    bool is_finished;
+    int ready_head;             // очередь готовых ходов читает только главный процесс
+    alignas(CACHE_LINE) std::atomic<uint32_t> ready_tail; // общий для всех игроков, не делит линию с ready_head
+    size_t slot_stride;         // шаг ячеек игроков: sizeof(PlayerSlot) или CACHE_LINE с --padded
+    int workers;                // размер пула воркеров, 0 - отдельный процесс на каждого игрока
+    int request_capacity;       // длина очереди запросов одного воркера
+    size_t slots_offset;
+    size_t opponent_offset;
+    size_t ready_offset;        // очередь игроков, уже сделавших ход; -1 - ячейка пуста
+    size_t requests_offset;     // очереди запросов хода, по request_capacity на воркера
+    size_t request_heads_offset;
+    size_t request_tails_offset;
+
+    template <typename T>
+    T* array(size_t offset) {
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(this) + offset);
+    }
+
+    PlayerSlot& slot(int player) { return *array<PlayerSlot>(slots_offset + player * slot_stride); }
+    int* opponent() { return array<int>(opponent_offset); }
+    std::atomic<int>* ready_players() { return array<std::atomic<int>>(ready_offset); }
+    int* requests(int worker) { return array<int>(requests_offset) + worker * request_capacity; }
+    int* request_heads() { return array<int>(request_heads_offset); }
+    int* request_tails() { return array<int>(request_tails_offset); }
 };
 
 std::vector<sem_t*> playerSems;
+std::vector<sem_t*> workerSems;
 std::vector<pid_t> playerPids;
 int n, shm_fd;
+size_t shmSize;
 TournamentState* tournamentState;
 sem_t* mainSem;
 sem_t* moveMadeSem;
+std::vector<uint32_t> takenSeq;  // последний seq каждого игрока, прочитанный главным процессом
+bool concurrent = false;
+bool dataflow = false;  // --dataflow: сетка без барьера между раундами
+bool pool = false;
+bool padded = false;
+int pipeline = 1;   // сколько ходов игрок выкладывает за один запрос
+int workers = 0;
+uint64_t seed = 0;      // сид турнира, без --seed выбирается случайно
+bool seeded = false;
+bool statsEnabled = false; // --stats: живые метрики для tourtop
+const char* traceFile = nullptr; // --trace FILE: трасса событий для chrome://tracing
 
-std::string moves[3] = {"камень", "ножницы", "бумага"};
 
 
-int referee(int move1, int move2) {
-    if (move1 == move2) {
-        return 0;
-    } else if (move1 == 0 && move2 == 1 || move1 == 1 && move2 == 2 || move1 == 2 && move2 == 0) {
-        return 1;
+// выделяет место под массив в сегменте и возвращает его смещение
+size_t placeArray(size_t& size, size_t bytes, size_t align) {
+    size = (size + align - 1) / align * align;
+    size_t offset = size;
+    size += bytes;
+    return offset;
+}
+
+// считает смещения массивов для n игроков и пула из workers воркеров, возвращает полный размер сегмента
+// с padded ячейка каждого игрока занимает свою кэш-линию, а массивы, которые пишет только
+// главный процесс, начинаются с новой линии и не делят ее с ячейками игроков
+size_t layoutState(TournamentState* layout, int n, int workers, bool padded) {
+    size_t size = sizeof(TournamentState);
+    size_t align = padded ? CACHE_LINE : alignof(int);
+    layout->slot_stride = padded ? CACHE_LINE : sizeof(PlayerSlot);
+    layout->workers = workers;
+    layout->request_capacity = workers > 0 ? (n + workers - 1) / workers : 0;
+    layout->slots_offset = placeArray(size, n * layout->slot_stride, padded ? CACHE_LINE : alignof(PlayerSlot));
+    layout->opponent_offset = placeArray(size, n * sizeof(int), align);
+    layout->ready_offset = placeArray(size, n * sizeof(std::atomic<int>), align);
+    layout->requests_offset = placeArray(size, workers * layout->request_capacity * sizeof(int), align);
+    layout->request_heads_offset = placeArray(size, workers * sizeof(int), alignof(int));
+    layout->request_tails_offset = placeArray(size, workers * sizeof(int), alignof(int));
+    return size;
+}
+
+// публикует ход игрока без блокировок: запись в свою ячейку и место в очереди через fetch_add
+void publishMove(int player, int move) {
+    PlayerSlot& slot = tournamentState->slot(player);
+    slot.move = move;
+    slot.seq.store(slot.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+    uint32_t pos = tournamentState->ready_tail.fetch_add(1) % tournamentState->total_players;
+    tournamentState->ready_players()[pos].store(player, std::memory_order_release);
+
+    tourTrace.event(TRACE_MOVE, player);
+    sem_post(moveMadeSem);
+}
+
+// генерирует pipeline ходов подряд и упаковывает их в одно число для ячейки игрока
+int generateMoves(PlayerRng& gen) {
+    int packed = 0;
+    for (int i = 0; i < pipeline; i++) {
+        packed |= nextMove(gen) << (2 * i);
     }
-    return 2;
-};
+    return packed;
+}
 
-void playerProcess(int id, TournamentState* tournamentState, sem_t* mainSem, sem_t* playerSem, sem_t* moveMadeSem) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> distrib(0, 2);
+void playerProcess(int id, sem_t* playerSem) {
+    tourTrace.attach(id, TRACE_PLAYER, id);
+    PlayerRng gen = playerRng(seed, id - 1);
         
     while (true) {
+        int64_t waitStart = tourStats.clock();
+        tourTrace.event(TRACE_WAIT);
         if (sem_wait(playerSem) == -1) {
             perror("sem_wait on player semaphore");
             exit(1);
         }
+
+        // is_finished и in_game главный процесс меняет до sem_post семафора игрока,
+        // поэтому после sem_wait их можно читать без мьютекса
+        if (tournamentState->is_finished || !tournamentState->slot(id - 1).in_game) {
+            break;
+        }
         
-        if (sem_wait(mainSem) == -1) {
-            perror("sem_wait on main semaphore");
+        tourStats.playerMoved(id - 1, waitStart);
+        tourTrace.event(TRACE_WAKE, id - 1);
+        publishMove(id - 1, generateMoves(gen));
+    }
+    
+    exit(0);
+}
+
+// воркер пула обслуживает игроков worker, worker + workers, ... из одной точки ожидания
+void workerProcess(int worker) {
+    tourTrace.attach(worker + 1, TRACE_WORKER, worker + 1);
+    // у каждого игрока шарда свой поток случайных чисел, тот же, что и у отдельного процесса игрока
+    std::vector<PlayerRng> gens;
+    for (int player = worker; player < n; player += workers) {
+        gens.push_back(playerRng(seed, player));
+    }
+
+    int* queue = tournamentState->requests(worker);
+    int& head = tournamentState->request_heads()[worker];
+
+    while (true) {
+        int64_t waitStart = tourStats.clock();
+        tourTrace.event(TRACE_WAIT);
+        if (sem_wait(workerSems[worker]) == -1) {
+            perror("sem_wait on worker semaphore");
             exit(1);
         }
-        
-        if (tournamentState->is_finished || !tournamentState->is_in_game[id - 1]) {
-            sem_post(mainSem);
+
+        if (tournamentState->is_finished) {
             break;
         }
-        
-        int move = distrib(gen);
-        tournamentState->players_moves[id - 1] = move;
-        
-        sem_post(mainSem);
-        sem_post(moveMadeSem);
+
+        // очередь запросов воркера однопоточная с обеих сторон: tail двигает только главный
+        // процесс, head только воркер, а запись и чтение разделены sem_post/sem_wait
+        int player = queue[head];
+        head = (head + 1) % tournamentState->request_capacity;
+
+        tourStats.playerMoved(player, waitStart);
+        tourTrace.event(TRACE_WAKE, player);
+        publishMove(player, generateMoves(gens[player / workers]));
     }
-    
+
     exit(0);
 }
 
 void handle_sigint(int sig) {
     std::cout << "Получен SIGINT, завершаю турнир и очищаю ресурсы..." << std::endl;
 
-    for (int i = 0; i < playerSems.size(); i++) {
+    if (tournamentState) {
+        tournamentState->is_finished = true;
+    }
+
+    for (size_t i = 0; i < playerSems.size(); i++) {
         sem_post(playerSems[i]);
     }
+    for (sem_t* sem : workerSems) {
+        sem_post(sem);
+    }
     
     for (pid_t pid : playerPids) {
         waitpid(pid, nullptr, 0);
@@ -94,16 +225,25 @@ void handle_sigint(int sig) {
     for (sem_t* sem : playerSems) {
         sem_close(sem);
     }
+    for (sem_t* sem : workerSems) {
+        sem_close(sem);
+    }
     
     if (mainSem) sem_close(mainSem);
     if (moveMadeSem) sem_close(moveMadeSem);
     
-    for (int i = 0; i < playerSems.size(); i++) {
+    for (size_t i = 0; i < playerSems.size(); i++) {
         std::string semName = PLAYER_SEM + std::to_string(i + 1);
         if (sem_unlink(semName.c_str()) == -1) {
             perror("sem_unlink");
         }
     }
+    for (size_t i = 0; i < workerSems.size(); i++) {
+        std::string semName = WORKER_SEM + std::to_string(i);
+        if (sem_unlink(semName.c_str()) == -1) {
+            perror("sem_unlink");
+        }
+    }
     
     if (sem_unlink(MAIN_SEM) == -1) {
         perror("sem_unlink");
@@ -113,24 +253,211 @@ void handle_sigint(int sig) {
     }
 
     
-    munmap(tournamentState, sizeof(TournamentState));
+    munmap(tournamentState, shmSize);
     close(shm_fd);
     shm_unlink(SHM_NAME);
     exit(0);
 };
 
-int main() {
+// ждет ход любого игрока и возвращает его номер
+int waitForMove() {
+    sem_wait(moveMadeSem);
+
+    // место в очереди игрок получает раньше, чем записывает в него свой номер, поэтому
+    // sem_post более позднего игрока может прийти, пока ячейка в голове очереди еще пуста
+    std::atomic<int>& cell = tournamentState->ready_players()[tournamentState->ready_head];
+    int player;
+    while ((player = cell.load(std::memory_order_acquire)) == -1) {
+        sched_yield();
+    }
+    cell.store(-1, std::memory_order_relaxed);
+    tournamentState->ready_head = (tournamentState->ready_head + 1) % tournamentState->total_players;
+
+    return player;
+}
+
+// забирает из ячейки игрока ход, который главный процесс еще не видел
+int takeMove(int player) {
+    PlayerSlot& slot = tournamentState->slot(player);
+    uint32_t seq;
+    while ((seq = slot.seq.load(std::memory_order_acquire)) == takenSeq[player]) {
+        sched_yield();
+    }
+    takenSeq[player] = seq;
+    return slot.move;
+}
+
+// транспорт для движка турнира: запрос хода - семафор игрока или очередь его воркера,
+// ход - ячейка игрока и номер в очереди ready_players
+struct SemTransport : TransportBase<SemTransport> {
+    int movesPerRequest() const {
+        return pipeline;
+    }
+
+    void requestMove(int player) {
+        if (!pool) {
+            sem_post(playerSems[player]);
+            return;
+        }
+
+        int worker = player % workers;
+        int& tail = tournamentState->request_tails()[worker];
+        tournamentState->requests(worker)[tail] = player;
+        tail = (tail + 1) % tournamentState->request_capacity;
+
+        sem_post(workerSems[worker]);
+    }
+
+    PlayerMove collectMove() {
+        int player = waitForMove();
+        return {player, takeMove(player)};
+    }
+
+    void onRoundStart(int round) {
+        sem_wait(mainSem);
+        tournamentState->current_round = round;
+        sem_post(mainSem);
+    }
+
+    void onMatchStart(const Match& match) {
+        sem_wait(mainSem);
+        tournamentState->opponent()[match.player1] = match.player2;
+        tournamentState->opponent()[match.player2] = match.player1;
+        sem_post(mainSem);
+    }
+
+    void onMatchDecided(int winner, int loser) {
+        sem_wait(mainSem);
+        tournamentState->slot(loser).in_game = false;
+        sem_post(mainSem);
+    }
+
+    void onFinish(int winner) {
+        sem_wait(mainSem);
+        tournamentState->tournament_winner = winner + 1;
+        tournamentState->is_finished = true;
+        sem_post(mainSem);
+    }
+
+    void shutdown() {
+        // освобождение игроков, чтобы они могли завершиться
+        for (sem_t* sem : playerSems) {
+            sem_post(sem);
+        }
+        for (sem_t* sem : workerSems) {
+            sem_post(sem);
+        }
+
+        for (pid_t pid : playerPids) {
+            waitpid(pid, nullptr, 0);
+        }
+
+        for (sem_t* sem : playerSems) {
+            sem_close(sem);
+        }
+        for (sem_t* sem : workerSems) {
+            sem_close(sem);
+        }
+
+        sem_close(mainSem);
+        sem_close(moveMadeSem);
+
+        for (size_t i = 0; i < playerSems.size(); i++) {
+            std::string semName = PLAYER_SEM + std::to_string(i + 1);
+            sem_unlink(semName.c_str());
+        }
+        for (size_t i = 0; i < workerSems.size(); i++) {
+            std::string semName = WORKER_SEM + std::to_string(i);
+            sem_unlink(semName.c_str());
+        }
+
+        sem_unlink(MAIN_SEM);
+        sem_unlink(MOVE_MADE_SEM);
+
+        munmap(tournamentState, shmSize);
+        close(shm_fd);
+        shm_unlink(SHM_NAME);
+    }
+};
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--concurrent") == 0) {
+            concurrent = true;
+        } else if (strcmp(argv[i], "--dataflow") == 0) {
+            dataflow = true;
+        } else if (strcmp(argv[i], "--players") == 0 && i + 1 < argc) {
+            n = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+            seeded = true;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            benchMode = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            statsEnabled = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+            if (!setLogLevel(argv[++i])) {
+                std::cerr << "Уровень лога: off, rounds, matches или moves" << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--pipeline") == 0 && i + 1 < argc) {
+            pipeline = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--padded") == 0) {
+            padded = true;
+        } else if (strcmp(argv[i], "--pool") == 0) {
+            pool = true;
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            pool = true;
+            workers = atoi(argv[++i]);
+        }
+    }
+
     struct sigaction sa{};
     sa.sa_handler = handle_sigint;
     sa.sa_flags = 0;
     sigaction(SIGINT, &sa, nullptr);
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> distrib(2, 101);
-    n = distrib(gen);
+    if (!seeded) {
+        seed = randomSeed();
+    }
+    if (n == 0) {
+        n = playersFromSeed(seed);
+    }
+    if (n < 2) {
+        std::cerr << "Количество игроков должно быть не меньше 2" << std::endl;
+        return 1;
+    }
+    if (pipeline < 1 || pipeline > MAX_PIPELINE) {
+        std::cerr << "Число ходов за запрос должно быть от 1 до " << MAX_PIPELINE << std::endl;
+        return 1;
+    }
 
     std::cout << "Количество игроков в турнире: " << n << std::endl;
+    std::cout << "Сид турнира: " << seed << std::endl;
+
+    // сегмент метрик создается до fork, чтобы игроки унаследовали его отображение
+    if (statsEnabled) {
+        if (!tourStats.create(n, "main_sem")) {
+            return 1;
+        }
+        std::cout << "Метрики: ./tourtop " << getpid() << std::endl;
+    }
+
+    if (pool) {
+        // по умолчанию по одному воркеру на ядро
+        if (workers <= 0) {
+            workers = sysconf(_SC_NPROCESSORS_ONLN);
+        }
+        workers = std::max(1, std::min(workers, n));
+        std::cout << "Игроков обслуживает пул из " << workers << " воркеров" << std::endl;
+    }
+
+    // буферы трассы, как и метрики, выделяются до fork: буфер 0 - судья, дальше игроки или воркеры
+    if (traceFile && !tourTrace.create(pool ? workers : n, traceFile)) {
+        return 1;
+    }
     
     shm_fd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0666);
     if (shm_fd == -1) {
@@ -138,12 +465,15 @@ int main() {
         return 1;
     }
     
-    if (ftruncate(shm_fd, sizeof(TournamentState)) == -1) {
+    TournamentState layout{};
+    shmSize = layoutState(&layout, n, pool ? workers : 0, padded);
+
+    if (ftruncate(shm_fd, shmSize) == -1) {
         perror("ftruncate");
         return 1;
     }
     
-    tournamentState = (TournamentState*) mmap(NULL, sizeof(TournamentState), 
+    tournamentState = (TournamentState*) mmap(NULL, shmSize, 
                                                PROT_READ | PROT_WRITE, MAP_SHARED, 
                                                shm_fd, 0);
     if (tournamentState == MAP_FAILED) {
@@ -151,16 +481,19 @@ int main() {
         return 1;
     }
     
-    memset(tournamentState, 0, sizeof(TournamentState));
+    memset(static_cast<void*>(tournamentState), 0, shmSize);
+    layoutState(tournamentState, n, pool ? workers : 0, padded);
 
     tournamentState->total_players = n;
     tournamentState->tournament_winner = -1;
     tournamentState->is_finished = false;
     tournamentState->current_round = 1;
     
+    takenSeq.assign(n, 0);
     for (int i = 0; i < n; i++) {
-        tournamentState->is_in_game[i] = true;
-        tournamentState->opponent[i] = -1;
+        tournamentState->slot(i).in_game = true;
+        tournamentState->opponent()[i] = -1;
+        tournamentState->ready_players()[i].store(-1);
     }
     
     mainSem = sem_open(MAIN_SEM, O_CREAT, 0666, 1);
@@ -176,166 +509,64 @@ int main() {
     }
 
     
-    for (int i = 0; i < n; i++) {
-        std::string semName = PLAYER_SEM + std::to_string(i + 1);
-        sem_t* playerSem = sem_open(semName.c_str(), O_CREAT, 0666, 0);
-        if (playerSem == SEM_FAILED) {
-            perror("sem_open (playerSem)");
-            return 1;
-        }
-        playerSems.push_back(playerSem);
-    }
-    
-    for (int i = 0; i < n; i++) {
-        pid_t pid = fork();
-        if (pid == -1) {
-            perror("fork");
-            return 1;
-        }
-        
-        if (pid == 0) {
-            playerProcess(i + 1, tournamentState, mainSem, playerSems[i], moveMadeSem);
-            exit(0);
+    if (pool) {
+        for (int i = 0; i < workers; i++) {
+            std::string semName = WORKER_SEM + std::to_string(i);
+            sem_t* workerSem = sem_open(semName.c_str(), O_CREAT, 0666, 0);
+            if (workerSem == SEM_FAILED) {
+                perror("sem_open (workerSem)");
+                return 1;
+            }
+            workerSems.push_back(workerSem);
         }
-        
-        playerPids.push_back(pid);
-    }
-    
-    int numRounds = static_cast<int>(std::ceil(std::log2(n))); // Кол-во раундов
-    
-    std::vector<int> activeStudents;
-    for (int i = 0; i < n; i++) {
-        activeStudents.push_back(i);
-    }
-    
-    for (int round = 1; round <= numRounds; round++) {
-        std::cout << "\nРаунд " << round << std::endl;
 
-        tournamentState->winners_count = 0;
-        
-        // Блокируем основной семафор
-        sem_wait(mainSem);
-        tournamentState->current_round = round;
-        sem_post(mainSem);
-        
-        int match_count = activeStudents.size() / 2;
-
-        if (activeStudents.size() - match_count * 2 == 1) {
-            int student_idx = activeStudents[activeStudents.size() - 1];
+        for (int i = 0; i < workers; i++) {
+            pid_t pid = fork();
+            if (pid == -1) {
+                perror("fork");
+                return 1;
+            }
 
-            std::cout << "Студент " << student_idx + 1 << " проходит в следующий раунд" << std::endl;
+            if (pid == 0) {
+                workerProcess(i);
+                exit(0);
+            }
 
-            sem_wait(mainSem);
-            tournamentState->round_winners[tournamentState->winners_count++] = student_idx;
-            sem_post(mainSem);
+            playerPids.push_back(pid);
         }
-        
-        for (int match = 0; match < match_count; match++) {
-            int player1 = activeStudents[match * 2];
-            int player2 = activeStudents[match * 2 + 1];
-            
-            std::cout << "Матч между " << player1 + 1 << " и " << player2 + 1 << std::endl;
-            
-            sem_wait(mainSem);
-            tournamentState->opponent[player1] = player2;
-            tournamentState->opponent[player2] = player1;
-            sem_post(mainSem);
-            
-            // триггер для игроков сделать ход
-            sem_post(playerSems[player1]);
-            sem_post(playerSems[player2]);
-            
-            bool matchDecided = false;
-            while (!matchDecided) {
-                // ждем пока два игрока сделают ход
-                sem_wait(moveMadeSem);
-                sem_wait(moveMadeSem);
-                
-                sem_wait(mainSem);
-                int choice1 = tournamentState->players_moves[player1];
-                int choice2 = tournamentState->players_moves[player2];
-                sem_post(mainSem);
-
-                std::cout << "   Игрок " << player1 + 1 << " выбрал " << moves[choice1] << std::endl;
-                std::cout << "   Игрок " << player2 + 1 << " выбрал " << moves[choice2] << std::endl;
-                
-                int result = referee(choice1, choice2);
-                if (result == 1) {
-                    
-                    std::cout << "  Игрок " << player1 + 1 << " победил" << std::endl;
-                    
-                    sem_wait(mainSem);
-                    tournamentState->is_in_game[player2] = false;
-                    tournamentState->round_winners[tournamentState->winners_count++] = player1;
-                    sem_post(mainSem);
-                    
-                    matchDecided = true;
-                } else if (result == 2) {
-                    std::cout << "  Игрок " << player2 + 1 << " победил" << std::endl;
-                    
-                    sem_wait(mainSem);
-                    tournamentState->is_in_game[player1] = false;
-                    tournamentState->round_winners[tournamentState->winners_count++] = player2;
-                    sem_post(mainSem);
-                    
-                    matchDecided = true;
-                } else {
-                    std::cout << "  Ничья, матч переигрывается... " << std::endl;
-                    
-                    // триггер для переигровки матча
-                    sem_post(playerSems[player1]);
-                    sem_post(playerSems[player2]);
-                }
+    } else {
+        for (int i = 0; i < n; i++) {
+            std::string semName = PLAYER_SEM + std::to_string(i + 1);
+            sem_t* playerSem = sem_open(semName.c_str(), O_CREAT, 0666, 0);
+            if (playerSem == SEM_FAILED) {
+                perror("sem_open (playerSem)");
+                return 1;
             }
+            playerSems.push_back(playerSem);
         }
         
-        // очистка списка активных игроков для следующего раунда
-        activeStudents.clear();
-        sem_wait(mainSem);
-        for (int i = 0; i < tournamentState->winners_count; i++) {
-            activeStudents.push_back(tournamentState->round_winners[i]);
-        }
-        sem_post(mainSem);
-        
-        // проверка на наличие победителя
-        if (activeStudents.size() == 1) {
-            sem_wait(mainSem);
-            tournamentState->tournament_winner = activeStudents[0] + 1;
-            tournamentState->is_finished = true;
-            sem_post(mainSem);
+        for (int i = 0; i < n; i++) {
+            pid_t pid = fork();
+            if (pid == -1) {
+                perror("fork");
+                return 1;
+            }
             
-            std::cout << "\nТурнир закончен, выиграл игрок под номером: " << tournamentState->tournament_winner << std::endl;
-            break;
+            if (pid == 0) {
+                playerProcess(i + 1, playerSems[i]);
+                exit(0);
+            }
+            
+            playerPids.push_back(pid);
         }
     }
     
-    // освобождение игроков, чтобы они могли завершиться
-    for (int i = 0; i < n; i++) {
-        sem_post(playerSems[i]);
-    }
-    
-    for (pid_t pid : playerPids) {
-        waitpid(pid, nullptr, 0);
-    }
-    
-    for (sem_t* sem : playerSems) {
-        sem_close(sem);
-    }
-    
-    sem_close(mainSem);
-    sem_close(moveMadeSem);
-    
-    for (int i = 0; i < n; i++) {
-        std::string semName = PLAYER_SEM + std::to_string(i + 1);
-        sem_unlink(semName.c_str());
-    }
-    
-    sem_unlink(MAIN_SEM);
-    sem_unlink(MOVE_MADE_SEM);
-    
-    munmap(tournamentState, sizeof(TournamentState));
-    close(shm_fd);
-    shm_unlink(SHM_NAME);
+    SemTransport transport;
+    Tournament<SemTransport> tournament(transport, n, concurrent, dataflow);
+    tournament.run();
+
+    transport.shutdown();
+    benchReport();
     
     return 0;
 } 
\ No newline at end of file
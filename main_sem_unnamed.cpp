@@ -1,6 +1,5 @@
 #include <iostream>
 #include <vector>
-#include <random>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <sys/types.h>
@@ -11,106 +10,698 @@
 #include <cmath>
 #include <signal.h>
 #include <string>
+#include <cstdint>
+#include <algorithm>
+
+#include "tournament.h"
+#include "rng.h"
 
 #define SHM_NAME "/main_shm"
 
+// в компактном режиме ход занимает 2 бита, а флаг is_in_game - 1 бит 64-битного слова
+#define MOVES_PER_WORD 32
+#define BITS_PER_WORD 64
+// сколько матчей компактный судья с --concurrent держит в полете; очередь ready_players
+// и очереди воркеров рассчитаны на ходы только этих матчей, а не на всех игроков
+#define COMPACT_WINDOW 4096
+
+// заголовок разделяемой памяти, массивы размера n лежат сразу за ним
 struct TournamentState {
-    int players_moves[100];  
-    bool is_in_game[100];            
-    int opponent[100];           
-    int tournament_winner;                   
-    int round_winners[100];       
-    int winners_count;         
-    int current_round;             
-    int total_players;            
-    bool is_finished;          
+    int tournament_winner;
+    int winners_count;
+    int current_round;
+    int total_players;
+    bool is_finished;
+    int ready_head;
+    int ready_tail;
+    int workers;                // размер пула воркеров, 0 - отдельный процесс на каждого игрока
+    int request_capacity;       // длина очереди запросов одного воркера
+    int ready_capacity;         // длина очереди ready_players: n, в компактном режиме - ходы матчей в полете
+    bool compact;               // ходы упакованы по 2 бита, is_in_game - битовое множество
     sem_t main_sem;
     sem_t move_made_sem;
-    sem_t player_sems[100];
+    size_t moves_offset;
+    size_t in_game_offset;
+    size_t opponent_offset;         // в компактном режиме не используется, соперник вычисляется по битам
+    size_t ready_offset;        // очередь игроков, уже сделавших ход
+    size_t player_sems_offset;
+    size_t worker_sems_offset;
+    size_t requests_offset;     // очереди запросов хода, по request_capacity на воркера
+    size_t request_heads_offset;
+    size_t request_tails_offset;
+
+    template <typename T>
+    T* array(size_t offset) {
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(this) + offset);
+    }
+
+    int* players_moves() { return array<int>(moves_offset); }
+    bool* is_in_game() { return array<bool>(in_game_offset); }
+    uint64_t* packed_moves() { return array<uint64_t>(moves_offset); }
+    uint64_t* in_game_bits() { return array<uint64_t>(in_game_offset); }
+    int* opponent() { return array<int>(opponent_offset); }
+    int* ready_players() { return array<int>(ready_offset); }
+    sem_t* player_sems() { return array<sem_t>(player_sems_offset); }
+    sem_t* worker_sems() { return array<sem_t>(worker_sems_offset); }
+    int* requests(int worker) { return array<int>(requests_offset) + worker * request_capacity; }
+    int* request_heads() { return array<int>(request_heads_offset); }
+    int* request_tails() { return array<int>(request_tails_offset); }
+
+    // доступ к ходу и флагу игрока в обоих режимах; вызывать под main_sem
+    int load_move(int player) {
+        if (!compact) {
+            return players_moves()[player];
+        }
+        return (packed_moves()[player / MOVES_PER_WORD] >> (player % MOVES_PER_WORD * 2)) & 3;
+    }
+
+    void store_move(int player, int move) {
+        if (!compact) {
+            players_moves()[player] = move;
+            return;
+        }
+        uint64_t& word = packed_moves()[player / MOVES_PER_WORD];
+        int shift = player % MOVES_PER_WORD * 2;
+        word = (word & ~(3ULL << shift)) | (static_cast<uint64_t>(move) << shift);
+    }
+
+    bool player_in_game(int player) {
+        if (!compact) {
+            return is_in_game()[player];
+        }
+        return (in_game_bits()[player / BITS_PER_WORD] >> (player % BITS_PER_WORD)) & 1;
+    }
 };
 
 std::vector<pid_t> playerPids;
 int n, shm_fd;
+size_t shmSize;
 TournamentState* tournamentState;
+bool concurrent = false;
+bool dataflow = false;  // --dataflow: сетка без барьера между раундами
+bool pool = false;
+bool compact = false;
+bool batch = false;
+int workers = 0;
+uint64_t seed = 0;      // сид турнира, без --seed выбирается случайно
+bool seeded = false;
+bool statsEnabled = false; // --stats: живые метрики для tourtop
+const char* traceFile = nullptr; // --trace FILE: трасса событий для chrome://tracing
 
-std::string moves[3] = {"камень", "ножницы", "бумага"};
 
-int referee(int move1, int move2) {
-    if (move1 == move2) {
-        return 0;
-    } else if (move1 == 0 && move2 == 1 || move1 == 1 && move2 == 2 || move1 == 2 && move2 == 0) {
-        return 1;
+// выделяет место под массив в сегменте и возвращает его смещение
+size_t placeArray(size_t& size, size_t bytes, size_t align) {
+    size = (size + align - 1) / align * align;
+    size_t offset = size;
+    size += bytes;
+    return offset;
+}
+
+// сколько матчей раунда компактный судья играет одновременно
+int compactWindow() {
+    return concurrent ? COMPACT_WINDOW : 1;
+}
+
+// считает смещения массивов для n игроков и пула из workers воркеров, возвращает полный размер сегмента.
+// У игрока в полете не больше одного хода, поэтому очередям хватает числа ходов в полете
+size_t layoutState(TournamentState* layout, int n, int workers, bool compact) {
+    size_t size = sizeof(TournamentState);
+    size_t bitWords = (n + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    size_t moveWords = (n + MOVES_PER_WORD - 1) / MOVES_PER_WORD;
+    layout->compact = compact;
+    layout->workers = workers;
+    layout->ready_capacity = compact ? std::min(n, 2 * compactWindow()) : n;
+    layout->request_capacity = workers > 0 ? std::min((n + workers - 1) / workers, layout->ready_capacity) : 0;
+    // в режиме пула семафоры есть только у воркеров
+    layout->player_sems_offset = placeArray(size, (workers > 0 ? 0 : n) * sizeof(sem_t), alignof(sem_t));
+    layout->worker_sems_offset = placeArray(size, workers * sizeof(sem_t), alignof(sem_t));
+    if (compact) {
+        layout->moves_offset = placeArray(size, moveWords * sizeof(uint64_t), alignof(uint64_t));
+        layout->in_game_offset = placeArray(size, bitWords * sizeof(uint64_t), alignof(uint64_t));
+    } else {
+        layout->moves_offset = placeArray(size, n * sizeof(int), alignof(int));
+        layout->opponent_offset = placeArray(size, n * sizeof(int), alignof(int));
+    }
+    layout->ready_offset = placeArray(size, layout->ready_capacity * sizeof(int), alignof(int));
+    layout->requests_offset = placeArray(size, workers * layout->request_capacity * sizeof(int), alignof(int));
+    layout->request_heads_offset = placeArray(size, workers * sizeof(int), alignof(int));
+    layout->request_tails_offset = placeArray(size, workers * sizeof(int), alignof(int));
+    if (!compact) {
+        layout->in_game_offset = placeArray(size, n * sizeof(bool), alignof(bool));
     }
-    return 2;
+    return size;
 }
 
 void playerProcess(int id, TournamentState* tournamentState) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> distrib(0, 2);
+    tourTrace.attach(id, TRACE_PLAYER, id);
+    PlayerRng gen = playerRng(seed, id - 1);
         
     while (true) {
-        if (sem_wait(&tournamentState->player_sems[id - 1]) == -1) {
+        int64_t waitStart = tourStats.clock();
+        tourTrace.event(TRACE_WAIT);
+        if (sem_wait(&tournamentState->player_sems()[id - 1]) == -1) {
             perror("sem_wait on player semaphore");
             exit(1);
         }
         
+        tourTrace.event(TRACE_LOCK);
         if (sem_wait(&tournamentState->main_sem) == -1) {
             perror("sem_wait on main semaphore");
             exit(1);
         }
+        tourTrace.event(TRACE_LOCKED);
         
-        if (tournamentState->is_finished || !tournamentState->is_in_game[id - 1]) {
+        if (tournamentState->is_finished || !tournamentState->player_in_game(id - 1)) {
             sem_post(&tournamentState->main_sem);
             break;
         }
         
-        int move = distrib(gen);
-        tournamentState->players_moves[id - 1] = move;
+        tourStats.playerMoved(id - 1, waitStart);
+        tourTrace.event(TRACE_WAKE, id - 1);
+        int move = nextMove(gen);
+        tournamentState->store_move(id - 1, move);
+        tournamentState->ready_players()[tournamentState->ready_tail] = id - 1;
+        tournamentState->ready_tail = (tournamentState->ready_tail + 1) % tournamentState->ready_capacity;
         
         sem_post(&tournamentState->main_sem);
+        tourTrace.event(TRACE_MOVE, id - 1);
         sem_post(&tournamentState->move_made_sem);
     }
     
     exit(0);
 }
 
+// воркер пула обслуживает игроков worker, worker + workers, ... из одной точки ожидания
+void workerProcess(int worker, TournamentState* tournamentState) {
+    tourTrace.attach(worker + 1, TRACE_WORKER, worker + 1);
+    // у каждого игрока шарда свой поток случайных чисел, тот же, что и у отдельного процесса игрока
+    std::vector<PlayerRng> gens;
+    for (int player = worker; player < n; player += workers) {
+        gens.push_back(playerRng(seed, player));
+    }
+
+    int* queue = tournamentState->requests(worker);
+    int& head = tournamentState->request_heads()[worker];
+
+    while (true) {
+        int64_t waitStart = tourStats.clock();
+        tourTrace.event(TRACE_WAIT);
+        if (sem_wait(&tournamentState->worker_sems()[worker]) == -1) {
+            perror("sem_wait on worker semaphore");
+            exit(1);
+        }
+
+        tourTrace.event(TRACE_LOCK);
+        if (sem_wait(&tournamentState->main_sem) == -1) {
+            perror("sem_wait on main semaphore");
+            exit(1);
+        }
+        tourTrace.event(TRACE_LOCKED);
+
+        if (tournamentState->is_finished) {
+            sem_post(&tournamentState->main_sem);
+            break;
+        }
+
+        int player = queue[head];
+        head = (head + 1) % tournamentState->request_capacity;
+
+        tourStats.playerMoved(player, waitStart);
+        tourTrace.event(TRACE_WAKE, player);
+        int move = nextMove(gens[player / workers]);
+        tournamentState->store_move(player, move);
+        tournamentState->ready_players()[tournamentState->ready_tail] = player;
+        tournamentState->ready_tail = (tournamentState->ready_tail + 1) % tournamentState->ready_capacity;
+
+        sem_post(&tournamentState->main_sem);
+        tourTrace.event(TRACE_MOVE, player);
+        sem_post(&tournamentState->move_made_sem);
+    }
+
+    exit(0);
+}
+
+// семафоры, на которых ждут дочерние процессы: игроков или воркеров пула
+sem_t* processSems() {
+    return pool ? tournamentState->worker_sems() : tournamentState->player_sems();
+}
+
+int processCount() {
+    return pool ? workers : n;
+}
+
 void handle_sigint(int sig) {
     std::cout << "Получен SIGINT, завершаю турнир и очищаю ресурсы..." << std::endl;
 
-    for (int i = 0; i < n; i++) {
-        sem_post(&tournamentState->player_sems[i]);
+    tournamentState->is_finished = true;
+    for (int i = 0; i < processCount(); i++) {
+        sem_post(&processSems()[i]);
     }
     
     for (pid_t pid : playerPids) {
         waitpid(pid, nullptr, 0);
     }
     
-    for (int i = 0; i < n; i++) {
-        sem_destroy(&tournamentState->player_sems[i]);
+    for (int i = 0; i < processCount(); i++) {
+        sem_destroy(&processSems()[i]);
     }
     
     sem_destroy(&tournamentState->main_sem);
     sem_destroy(&tournamentState->move_made_sem);
     
-    munmap(tournamentState, sizeof(TournamentState));
+    munmap(tournamentState, shmSize);
     close(shm_fd);
     shm_unlink(SHM_NAME);
     exit(0);
 }
 
-int main() {
+// просит игрока сделать ход: напрямую через его семафор или через очередь его воркера
+void requestMove(int player) {
+    if (!pool) {
+        sem_post(&tournamentState->player_sems()[player]);
+        return;
+    }
+
+    int worker = player % workers;
+    sem_wait(&tournamentState->main_sem);
+    int& tail = tournamentState->request_tails()[worker];
+    tournamentState->requests(worker)[tail] = player;
+    tail = (tail + 1) % tournamentState->request_capacity;
+    sem_post(&tournamentState->main_sem);
+
+    sem_post(&tournamentState->worker_sems()[worker]);
+}
+
+// запуск матча в компактном режиме: массива соперников нет, соперник вычисляется по битам is_in_game
+void startCompactMatch(int match, int player1, int player2) {
+    tourLog.matchStart(match, player1, player2);
+
+    tourTrace.event(TRACE_REQUEST, player1);
+    requestMove(player1);
+    tourTrace.event(TRACE_REQUEST, player2);
+    requestMove(player2);
+}
+
+// ждет ход любого игрока и возвращает его номер
+int waitForMove() {
+    sem_wait(&tournamentState->move_made_sem);
+
+    sem_wait(&tournamentState->main_sem);
+    int player = tournamentState->ready_players()[tournamentState->ready_head];
+    tournamentState->ready_head = (tournamentState->ready_head + 1) % tournamentState->ready_capacity;
+    sem_post(&tournamentState->main_sem);
+
+    return player;
+}
+
+// транспорт для движка турнира: запрос хода - семафор игрока или очередь его воркера,
+// ход - массив ходов и очередь ready_players под main_sem
+struct UnnamedSemTransport : TransportBase<UnnamedSemTransport> {
+    void requestMove(int player) {
+        ::requestMove(player);
+    }
+
+    PlayerMove collectMove() {
+        int player = waitForMove();
+        sem_wait(&tournamentState->main_sem);
+        int move = tournamentState->players_moves()[player];
+        sem_post(&tournamentState->main_sem);
+        return {player, move};
+    }
+
+    void onRoundStart(int round) {
+        sem_wait(&tournamentState->main_sem);
+        tournamentState->current_round = round;
+        sem_post(&tournamentState->main_sem);
+    }
+
+    void onMatchStart(const Match& match) {
+        sem_wait(&tournamentState->main_sem);
+        tournamentState->opponent()[match.player1] = match.player2;
+        tournamentState->opponent()[match.player2] = match.player1;
+        sem_post(&tournamentState->main_sem);
+    }
+
+    void onMatchDecided(int winner, int loser) {
+        sem_wait(&tournamentState->main_sem);
+        tournamentState->is_in_game()[loser] = false;
+        sem_post(&tournamentState->main_sem);
+    }
+
+    void onFinish(int winner) {
+        sem_wait(&tournamentState->main_sem);
+        tournamentState->tournament_winner = winner + 1;
+        tournamentState->is_finished = true;
+        sem_post(&tournamentState->main_sem);
+    }
+
+    // пакетный режим: раунд играется волнами. Главная программа просит ходы у всех игроков
+    // неразыгранных матчей, дожидается всех ходов волны и судит ее одним вызовом refereeBatch.
+    // Следующая волна - только матчи, закончившиеся ничьей
+    template <typename Engine>
+    void playRound(Engine& engine, std::vector<Match>& matches, int winners_offset) {
+        if (!batch) {
+            engine.playMatches(*this, matches, winners_offset);
+            return;
+        }
+
+        std::vector<uint32_t> pending(matches.size());
+        for (size_t i = 0; i < matches.size(); i++) {
+            pending[i] = i;
+        }
+        std::vector<uint8_t> left, right, results;
+        std::vector<uint32_t> draws(matches.size());
+
+        bool firstWave = true;
+        while (!pending.empty()) {
+            for (uint32_t idx : pending) {
+                if (firstWave) {
+                    engine.startMatch(*this, matches[idx]);
+                } else {
+                    engine.requestMove(*this, matches[idx].player1);
+                    engine.requestMove(*this, matches[idx].player2);
+                }
+            }
+            firstWave = false;
+
+            // номера игроков из очереди не нужны: после всех ходов волны они уже лежат в разделяемой памяти
+            for (size_t k = 0; k < 2 * pending.size(); k++) {
+                tourTrace.event(TRACE_REFEREE_WAIT);
+                int player = waitForMove();
+                tourTrace.event(TRACE_REFEREE_WAKE, player);
+            }
+
+            size_t count = pending.size();
+            left.resize(count);
+            right.resize(count);
+            results.resize(count);
+            sem_wait(&tournamentState->main_sem);
+            for (size_t j = 0; j < count; j++) {
+                left[j] = tournamentState->load_move(matches[pending[j]].player1);
+                right[j] = tournamentState->load_move(matches[pending[j]].player2);
+            }
+            sem_post(&tournamentState->main_sem);
+
+            size_t drawCount = refereeBatch(left.data(), right.data(), results.data(), count, draws.data());
+
+            for (size_t j = 0; j < count; j++) {
+                engine.reportResult(*this, matches[pending[j]], pending[j], winners_offset, left[j], right[j], results[j]);
+            }
+
+            for (size_t k = 0; k < drawCount; k++) {
+                draws[k] = pending[draws[k]];
+            }
+            pending.assign(draws.begin(), draws.begin() + drawCount);
+        }
+    }
+
+    void shutdown() {
+        for (int i = 0; i < processCount(); i++) {
+            sem_post(&processSems()[i]);
+        }
+
+        for (pid_t pid : playerPids) {
+            waitpid(pid, nullptr, 0);
+        }
+
+        for (int i = 0; i < processCount(); i++) {
+            sem_destroy(&processSems()[i]);
+        }
+
+        sem_destroy(&tournamentState->main_sem);
+        sem_destroy(&tournamentState->move_made_sem);
+
+        munmap(tournamentState, shmSize);
+        close(shm_fd);
+        shm_unlink(SHM_NAME);
+    }
+};
+
+// первый установленный бит с номером >= from, или -1
+int nextSetBit(const uint64_t* bits, int words, int from) {
+    int w = from / BITS_PER_WORD;
+    if (w >= words) {
+        return -1;
+    }
+    uint64_t word = bits[w] & (~0ULL << (from % BITS_PER_WORD));
+    while (word == 0) {
+        if (++w == words) {
+            return -1;
+        }
+        word = bits[w];
+    }
+    return w * BITS_PER_WORD + __builtin_ctzll(word);
+}
+
+// последний установленный бит с номером <= to, или -1
+int prevSetBit(const uint64_t* bits, int to) {
+    if (to < 0) {
+        return -1;
+    }
+    int w = to / BITS_PER_WORD;
+    uint64_t word = bits[w] & (~0ULL >> (BITS_PER_WORD - 1 - to % BITS_PER_WORD));
+    while (word == 0) {
+        if (w-- == 0) {
+            return -1;
+        }
+        word = bits[w];
+    }
+    return w * BITS_PER_WORD + BITS_PER_WORD - 1 - __builtin_clzll(word);
+}
+
+bool testBit(const std::vector<uint64_t>& bits, int i) {
+    return (bits[i / BITS_PER_WORD] >> (i % BITS_PER_WORD)) & 1;
+}
+
+void flipBit(std::vector<uint64_t>& bits, int i) {
+    bits[i / BITS_PER_WORD] ^= 1ULL << (i % BITS_PER_WORD);
+}
+
+// компактный режим: сетка не хранится. Живые игроки - это биты is_in_game, в раунде играют
+// соседние по номеру живые игроки (1-й со 2-м, 3-й с 4-м, ...), лишний последний проходит дальше.
+// Соперника дает ранг игрока среди живых: четный ранг - следующий живой бит, нечетный - предыдущий
+void runCompactTournament() {
+    int words = (n + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    uint64_t* alive = tournamentState->in_game_bits();
+    std::vector<uint64_t> lost(words);       // проигравшие раунда, снимаются с alive в конце раунда
+    std::vector<uint64_t> moved(words);      // игроки, чей ход уже пришел, а ход соперника еще нет
+    std::vector<int> rankBefore(words);      // число живых игроков в словах до данного
+
+    int numRounds = static_cast<int>(std::ceil(std::log2(n)));
+    int survivors = n;
+
+    tourLog.start();
+    benchStats.runStart = std::chrono::steady_clock::now();
+    long movesPlayed = 0;
+    for (int round = 1; round <= numRounds; round++) {
+        int match_count = survivors / 2;
+        tourLog.roundStart(round, match_count, survivors % 2 == 1 ? prevSetBit(alive, n - 1) : -1);
+        tourStats.roundStart(round, match_count);
+        tourTrace.event(TRACE_ROUND_BEGIN, round);
+
+        sem_wait(&tournamentState->main_sem);
+        tournamentState->current_round = round;
+        sem_post(&tournamentState->main_sem);
+
+        int rank = 0;
+        for (int w = 0; w < words; w++) {
+            rankBefore[w] = rank;
+            rank += __builtin_popcountll(alive[w]);
+        }
+
+        // ранг игрока среди живых; номер его матча - ранг пополам
+        auto rankOf = [&](int player) {
+            int w = player / BITS_PER_WORD;
+            uint64_t below = (1ULL << (player % BITS_PER_WORD)) - 1;
+            return rankBefore[w] + __builtin_popcountll(alive[w] & below);
+        };
+        auto opponentOf = [&](int player) {
+            return rankOf(player) % 2 == 0 ? nextSetBit(alive, words, player + 1) : prevSetBit(alive, player - 1);
+        };
+
+        // матчи запускаются по порядку, cursor - первый игрок, еще не попавший в матч
+        int cursor = 0;
+        int started = 0;
+        auto startNextMatch = [&]() {
+            int player1 = nextSetBit(alive, words, cursor);
+            int player2 = nextSetBit(alive, words, player1 + 1);
+            cursor = player2 + 1;
+            startCompactMatch(started, player1, player2);
+        };
+
+        int window = compactWindow();
+        int decided = 0;
+        int draws = 0;
+        while (started < window && started < match_count) {
+            startNextMatch();
+            started++;
+        }
+
+        while (decided < match_count) {
+            int64_t waitStart = tourStats.clock();
+            tourTrace.event(TRACE_REFEREE_WAIT);
+            int player = waitForMove();
+            tourTrace.event(TRACE_REFEREE_WAKE, player);
+            tourStats.refereeWaited(waitStart);
+            int other = opponentOf(player);
+            flipBit(moved, player);
+            if (!testBit(moved, other)) {
+                continue;
+            }
+            flipBit(moved, player);
+            flipBit(moved, other);
+
+            int player1 = std::min(player, other);
+            int player2 = std::max(player, other);
+
+            sem_wait(&tournamentState->main_sem);
+            int choice1 = tournamentState->load_move(player1);
+            int choice2 = tournamentState->load_move(player2);
+            sem_post(&tournamentState->main_sem);
+
+            int match = rankOf(player1) / 2;
+            tourLog.attempt(match, choice1, choice2);
+            movesPlayed += 2;
+
+            int result = referee(choice1, choice2);
+            tourStats.attempt(result == 0);
+            if (result == 0) {
+                draws++;
+                tourTrace.event(TRACE_DRAW, player1);
+                tourTrace.event(TRACE_REQUEST, player1);
+                requestMove(player1);
+                tourTrace.event(TRACE_REQUEST, player2);
+                requestMove(player2);
+                continue;
+            }
+
+            int winner = result == 1 ? player1 : player2;
+            int loser = result == 1 ? player2 : player1;
+            tourLog.matchDecided(match, winner);
+            tourStats.matchDone(round);
+            tourTrace.event(TRACE_DECIDE, winner);
+            flipBit(lost, loser);
+
+            decided++;
+            if (started < match_count) {
+                startNextMatch();
+                started++;
+            }
+        }
+
+        // проигравшие выбывают одной операцией на слово, выжившие считаются через popcount
+        survivors = 0;
+        sem_wait(&tournamentState->main_sem);
+        for (int w = 0; w < words; w++) {
+            alive[w] &= ~lost[w];
+            lost[w] = 0;
+            survivors += __builtin_popcountll(alive[w]);
+        }
+        tournamentState->winners_count = survivors;
+        sem_post(&tournamentState->main_sem);
+        tourTrace.event(TRACE_ROUND_END);
+        tourLog.roundEnd(match_count, draws);
+
+        if (survivors == 1) {
+            sem_wait(&tournamentState->main_sem);
+            tournamentState->tournament_winner = nextSetBit(alive, words, 0) + 1;
+            tourStats.finish(tournamentState->tournament_winner - 1);
+            tournamentState->is_finished = true;
+            sem_post(&tournamentState->main_sem);
+            break;
+        }
+    }
+
+    tourLog.stop();
+    benchStats.runEnd = std::chrono::steady_clock::now();
+    benchStats.matches = n - 1;
+    benchStats.moves = movesPlayed;
+    std::cout << "\nТурнир закончен, выиграл игрок под номером: " << tournamentState->tournament_winner << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--concurrent") == 0) {
+            concurrent = true;
+        } else if (strcmp(argv[i], "--dataflow") == 0) {
+            dataflow = true;
+        } else if (strcmp(argv[i], "--players") == 0 && i + 1 < argc) {
+            n = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+            seeded = true;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            benchMode = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            statsEnabled = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+            if (!setLogLevel(argv[++i])) {
+                std::cerr << "Уровень лога: off, rounds, matches или moves" << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            batch = true;
+        } else if (strcmp(argv[i], "--compact") == 0) {
+            compact = true;
+        } else if (strcmp(argv[i], "--pool") == 0) {
+            pool = true;
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            pool = true;
+            workers = atoi(argv[++i]);
+        }
+    }
+
     struct sigaction sa{};
     sa.sa_handler = handle_sigint;
     sa.sa_flags = 0;
     sigaction(SIGINT, &sa, nullptr);
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> distrib(2, 101);
-    n = distrib(gen);
+    if (!seeded) {
+        seed = randomSeed();
+    }
+    if (n == 0) {
+        n = playersFromSeed(seed);
+    }
+    if (n < 2) {
+        std::cerr << "Количество игроков должно быть не меньше 2" << std::endl;
+        return 1;
+    }
+
+    if (batch && compact) {
+        std::cerr << "Флаги --batch и --compact несовместимы" << std::endl;
+        return 1;
+    }
+    if (dataflow && (batch || compact)) {
+        std::cerr << "Флаг --dataflow не сочетается с --batch и --compact: они играют раунд целиком" << std::endl;
+        return 1;
+    }
 
     std::cout << "Количество игроков в турнире: " << n << std::endl;
+    std::cout << "Сид турнира: " << seed << std::endl;
+
+    // сегмент метрик создается до fork, чтобы игроки унаследовали его отображение
+    if (statsEnabled) {
+        if (!tourStats.create(n, "main_sem_unnamed")) {
+            return 1;
+        }
+        std::cout << "Метрики: ./tourtop " << getpid() << std::endl;
+    }
+
+    if (pool) {
+        // по умолчанию по одному воркеру на ядро
+        if (workers <= 0) {
+            workers = sysconf(_SC_NPROCESSORS_ONLN);
+        }
+        workers = std::max(1, std::min(workers, n));
+        std::cout << "Игроков обслуживает пул из " << workers << " воркеров" << std::endl;
+    }
+
+    // буферы трассы, как и метрики, выделяются до fork: буфер 0 - судья, дальше игроки или воркеры
+    if (traceFile && !tourTrace.create(pool ? workers : n, traceFile)) {
+        return 1;
+    }
     
     shm_fd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0666);
     if (shm_fd == -1) {
@@ -118,12 +709,15 @@ int main() {
         return 1;
     }
     
-    if (ftruncate(shm_fd, sizeof(TournamentState)) == -1) {
+    TournamentState layout{};
+    shmSize = layoutState(&layout, n, pool ? workers : 0, compact);
+
+    if (ftruncate(shm_fd, shmSize) == -1) {
         perror("ftruncate");
         return 1;
     }
     
-    tournamentState = (TournamentState*) mmap(NULL, sizeof(TournamentState), 
+    tournamentState = (TournamentState*) mmap(NULL, shmSize, 
                                                PROT_READ | PROT_WRITE, MAP_SHARED, 
                                                shm_fd, 0);
     if (tournamentState == MAP_FAILED) {
@@ -131,7 +725,8 @@ int main() {
         return 1;
     }
     
-    memset(tournamentState, 0, sizeof(TournamentState));
+    memset(tournamentState, 0, shmSize);
+    *tournamentState = layout;
 
     // Инициализация семафоров
     if (sem_init(&tournamentState->main_sem, 1, 1) == -1) {
@@ -144,8 +739,8 @@ int main() {
         return 1;
     }
     
-    for (int i = 0; i < n; i++) {
-        if (sem_init(&tournamentState->player_sems[i], 1, 0) == -1) {
+    for (int i = 0; i < processCount(); i++) {
+        if (sem_init(&processSems()[i], 1, 0) == -1) {
             perror("sem_init (player_sem)");
             return 1;
         }
@@ -156,12 +751,20 @@ int main() {
     tournamentState->is_finished = false;
     tournamentState->current_round = 1;
     
-    for (int i = 0; i < n; i++) {
-        tournamentState->is_in_game[i] = true;
-        tournamentState->opponent[i] = -1;
+    if (compact) {
+        // все биты is_in_game до n-го включительно
+        for (int i = 0; i < n; i += BITS_PER_WORD) {
+            int count = std::min(BITS_PER_WORD, n - i);
+            tournamentState->in_game_bits()[i / BITS_PER_WORD] = count == BITS_PER_WORD ? ~0ULL : (1ULL << count) - 1;
+        }
+    } else {
+        for (int i = 0; i < n; i++) {
+            tournamentState->is_in_game()[i] = true;
+            tournamentState->opponent()[i] = -1;
+        }
     }
     
-    for (int i = 0; i < n; i++) {
+    for (int i = 0; i < processCount(); i++) {
         pid_t pid = fork();
         if (pid == -1) {
             perror("fork");
@@ -169,132 +772,27 @@ int main() {
         }
         
         if (pid == 0) {
-            playerProcess(i + 1, tournamentState);
+            if (pool) {
+                workerProcess(i, tournamentState);
+            } else {
+                playerProcess(i + 1, tournamentState);
+            }
             exit(0);
         }
         
         playerPids.push_back(pid);
     }
     
-    int numRounds = static_cast<int>(std::ceil(std::log2(n)));
-    
-    std::vector<int> activeStudents;
-    for (int i = 0; i < n; i++) {
-        activeStudents.push_back(i);
+    UnnamedSemTransport transport;
+    if (compact) {
+        runCompactTournament();
+    } else {
+        Tournament<UnnamedSemTransport> tournament(transport, n, concurrent, dataflow);
+        tournament.run();
     }
-    
-    for (int round = 1; round <= numRounds; round++) {
-        std::cout << "\nРаунд " << round << std::endl;
-
-        tournamentState->winners_count = 0;
-        
-        sem_wait(&tournamentState->main_sem);
-        tournamentState->current_round = round;
-        sem_post(&tournamentState->main_sem);
-        
-        int match_count = activeStudents.size() / 2;
 
-        if (activeStudents.size() - match_count * 2 == 1) {
-            int student_idx = activeStudents[activeStudents.size() - 1];
-
-            std::cout << "Студент " << student_idx + 1 << " проходит в следующий раунд" << std::endl;
-
-            sem_wait(&tournamentState->main_sem);
-            tournamentState->round_winners[tournamentState->winners_count++] = student_idx;
-            sem_post(&tournamentState->main_sem);
-        }
-        
-        for (int match = 0; match < match_count; match++) {
-            int player1 = activeStudents[match * 2];
-            int player2 = activeStudents[match * 2 + 1];
-            
-            std::cout << "Матч между " << player1 + 1 << " и " << player2 + 1 << std::endl;
-            
-            sem_wait(&tournamentState->main_sem);
-            tournamentState->opponent[player1] = player2;
-            tournamentState->opponent[player2] = player1;
-            sem_post(&tournamentState->main_sem);
-            
-            sem_post(&tournamentState->player_sems[player1]);
-            sem_post(&tournamentState->player_sems[player2]);
-            
-            bool matchDecided = false;
-            while (!matchDecided) {
-                sem_wait(&tournamentState->move_made_sem);
-                sem_wait(&tournamentState->move_made_sem);
-                
-                sem_wait(&tournamentState->main_sem);
-                int choice1 = tournamentState->players_moves[player1];
-                int choice2 = tournamentState->players_moves[player2];
-                sem_post(&tournamentState->main_sem);
-                
-                std::cout << "   Игрок " << player1 + 1 << " выбрал " << moves[choice1] << std::endl;
-                std::cout << "   Игрок " << player2 + 1 << " выбрал " << moves[choice2] << std::endl;
-                
-                int result = referee(choice1, choice2);
-                if (result == 1) {
-                    std::cout << "  Игрок " << player1 + 1 << " победил" << std::endl;
-                    
-                    sem_wait(&tournamentState->main_sem);
-                    tournamentState->is_in_game[player2] = false;
-                    tournamentState->round_winners[tournamentState->winners_count++] = player1;
-                    sem_post(&tournamentState->main_sem);
-                    
-                    matchDecided = true;
-                } else if (result == 2) {
-                    std::cout << "  Игрок " << player2 + 1 << " победил" << std::endl;
-                    
-                    sem_wait(&tournamentState->main_sem);
-                    tournamentState->is_in_game[player1] = false;
-                    tournamentState->round_winners[tournamentState->winners_count++] = player2;
-                    sem_post(&tournamentState->main_sem);
-                    
-                    matchDecided = true;
-                } else {
-                    std::cout << "  Ничья, матч переигрывается... " << std::endl;
-                    
-                    sem_post(&tournamentState->player_sems[player1]);
-                    sem_post(&tournamentState->player_sems[player2]);
-                }
-            }
-        }
-        
-        activeStudents.clear();
-        sem_wait(&tournamentState->main_sem);
-        for (int i = 0; i < tournamentState->winners_count; i++) {
-            activeStudents.push_back(tournamentState->round_winners[i]);
-        }
-        sem_post(&tournamentState->main_sem);
-        
-        if (activeStudents.size() == 1) {
-            sem_wait(&tournamentState->main_sem);
-            tournamentState->tournament_winner = activeStudents[0] + 1;
-            tournamentState->is_finished = true;
-            sem_post(&tournamentState->main_sem);
-            
-            std::cout << "\nТурнир закончен, выиграл игрок под номером: " << tournamentState->tournament_winner << std::endl;
-            break;
-        }
-    }
-    
-    for (int i = 0; i < n; i++) {
-        sem_post(&tournamentState->player_sems[i]);
-    }
-    
-    for (pid_t pid : playerPids) {
-        waitpid(pid, nullptr, 0);
-    }
-    
-    for (int i = 0; i < n; i++) {
-        sem_destroy(&tournamentState->player_sems[i]);
-    }
-    
-    sem_destroy(&tournamentState->main_sem);
-    sem_destroy(&tournamentState->move_made_sem);
-    
-    munmap(tournamentState, sizeof(TournamentState));
-    close(shm_fd);
-    shm_unlink(SHM_NAME);
+    transport.shutdown();
+    benchReport();
     
     return 0;
 } 
\ No newline at end of file
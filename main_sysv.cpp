@@ -1,6 +1,5 @@
 #include <iostream>
 #include <vector>
-#include <random>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <sys/types.h>
@@ -8,9 +7,19 @@
 #include <sys/shm.h>
 #include <sys/sem.h>
 #include <cstring>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
 #include <cmath>
 #include <signal.h>
 #include <string>
+#include <atomic>
+#include <cstdint>
+#include <sched.h>
+#include <algorithm>
+
+#include "tournament.h"
+#include "rng.h"
 
 // union для семафоров
 union semun {
@@ -22,123 +31,512 @@ union semun {
 // номера семафоров для удобства
 #define SEM_MAIN 0 
 #define SEM_MOVE 1
-#define SEM_PLAYER_START 2 
+#define SEM_PLAYER_START 2 // в режиме пула с этого номера идут семафоры воркеров
+
+#define CACHE_LINE 64
+#define MAX_PIPELINE 16 // столько ходов по 2 бита помещается в int ячейки игрока
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "атомики в разделяемой памяти должны быть lock-free");
+static_assert(std::atomic<int>::is_always_lock_free, "атомики в разделяемой памяти должны быть lock-free");
+
+// ячейка хода игрока: пишет в нее только сам игрок (или его воркер), читает только главный процесс.
+// seq растет на каждый опубликованный ход, ход становится виден после release-записи seq.
+// in_game меняет главный процесс, но читает только сам игрок, поэтому он лежит рядом с ходом.
+// С --pipeline K в move упаковано K следующих ходов по 2 бита, первый в младших битах
+struct PlayerSlot {
+    std::atomic<uint32_t> seq;
+    int move;
+    bool in_game;
+};
 
+// заголовок разделяемой памяти, массивы размера n лежат сразу за ним
 struct TournamentState {
-    int players_moves[100];
-    bool is_in_game[100];
-    int opponent[100];
     int tournament_winner;
-    int round_winners[100];
-    int winners_count;
     int current_round;
     int total_players;
     bool is_finished;
+    int ready_head;         // очередь готовых ходов читает только главный процесс
+    alignas(CACHE_LINE) std::atomic<uint32_t> ready_tail; // общий для всех игроков, не делит линию с ready_head
+    std::atomic<int> referee_sleeping; // главный процесс спит на SEM_MOVE, см. sleepUntil()
+    size_t slot_stride;         // шаг ячеек игроков: sizeof(PlayerSlot) или CACHE_LINE с --padded
+    int workers;            // размер пула воркеров, 0 - отдельный процесс на каждого игрока
+    int request_capacity;   // длина очереди запросов одного воркера
+    size_t slots_offset;
+    size_t opponent_offset;
+    size_t ready_offset;        // очередь игроков, уже сделавших ход; -1 - ячейка пуста
+    size_t requests_offset;     // очереди запросов хода, по request_capacity на воркера
+    size_t request_heads_offset;
+    size_t request_tails_offset;
+    size_t request_sleeping_offset; // флаги воркеров, уснувших на своем семафоре
+
+    template <typename T>
+    T* array(size_t offset) {
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(this) + offset);
+    }
+
+    PlayerSlot& slot(int player) { return *array<PlayerSlot>(slots_offset + player * slot_stride); }
+    int* opponent() { return array<int>(opponent_offset); }
+    std::atomic<int>* ready_players() { return array<std::atomic<int>>(ready_offset); }
+    int* requests(int worker) { return array<int>(requests_offset) + worker * request_capacity; }
+    int* request_heads() { return array<int>(request_heads_offset); }
+    std::atomic<int>* request_tails() { return array<std::atomic<int>>(request_tails_offset); }
+    std::atomic<int>* request_sleeping() { return array<std::atomic<int>>(request_sleeping_offset); }
 };
 
 int semid = -1;
 int shmid = -1;
+size_t shmSize;
 TournamentState *tournamentState;
+std::vector<uint32_t> takenSeq;  // последний seq каждого игрока, прочитанный главным процессом
 std::vector<pid_t> playerPids;
 int n;
-std::string moves[3] = {"камень", "ножницы", "бумага"};
+bool concurrent = false;
+bool dataflow = false;  // --dataflow: сетка без барьера между раундами
+bool pool = false;
+bool padded = false;
+int pipeline = 1;   // сколько ходов игрок выкладывает за один запрос
+int workers = 0;
+uint64_t seed = 0;      // сид турнира, без --seed выбирается случайно
+bool seeded = false;
+bool statsEnabled = false; // --stats: живые метрики для tourtop
+const char* traceFile = nullptr; // --trace FILE: трасса событий для chrome://tracing
+pid_t ownerPid;     // главный процесс, только он освобождает ресурсы
+
+// дожидается дочерних процессов и удаляет набор семафоров и сегмент. Вызывает только главный процесс.
+// С killChildren дочерние процессы не ждут своего последнего запроса, а снимаются SIGKILL
+void releaseResources(bool killChildren) {
+    for (pid_t pid : playerPids) {
+        if (killChildren) {
+            kill(pid, SIGKILL);
+        }
+        if (waitpid(pid, nullptr, 0) == -1) {
+            perror("waitpid");
+        }
+    }
+    playerPids.clear();
+
+    if (semid != -1) {
+        if (semctl(semid, 0, IPC_RMID) == -1) {
+            perror("semctl IPC_RMID");
+        }
+        semid = -1;
+    }
+    if (tournamentState) {
+        if (shmdt(tournamentState) == -1) {
+            perror("shmdt");
+        }
+        tournamentState = nullptr;
+    }
+    if (shmid != -1) {
+        if (shmctl(shmid, IPC_RMID, nullptr) == -1) {
+            perror("shmctl IPC_RMID");
+        }
+        shmid = -1;
+    }
+}
+
+// ошибка semop. Главный процесс освобождает ресурсы сам, дочерний сообщает о ней главному через
+// SIGUSR1 и завершается. EIDRM у дочернего значит, что главный уже удалил семафоры и молчать можно
+[[noreturn]] void semFailure(const char* what) {
+    int error = errno;
+    if (getpid() != ownerPid) {
+        if (error != EIDRM) {
+            perror(what);
+            kill(ownerPid, SIGUSR1);
+        }
+        exit(1);
+    }
+    perror(what);
+    releaseResources(true);
+    exit(1);
+}
+
+void handle_child_failure(int sig) {
+    std::cerr << "Дочерний процесс завершился с ошибкой, очищаю ресурсы..." << std::endl;
+    releaseResources(true);
+    exit(1);
+}
 
 // функция wait для семафора system v
 void sem_wait_sysv(int semnum) {
     struct sembuf arg{
-        .sem_num = static_cast<short>(semnum),
+        .sem_num = static_cast<unsigned short>(semnum),
         .sem_op = -1,
         .sem_flg = 0
     };
     if (semop(semid, &arg, 1) == -1) {
-        perror("semop wait");
-        exit(1);
+        semFailure("semop wait");
     }
 }
 
 // функция post для семафора system v
 void sem_post_sysv(int semnum) {
     struct sembuf arg{
-        .sem_num = static_cast<short>(semnum),
+        .sem_num = static_cast<unsigned short>(semnum),
         .sem_op = 1,
         .sem_flg = 0
     };
     if (semop(semid, &arg, 1) == -1) {
-        perror("semop signal");
-        exit(1);
+        semFailure("semop signal");
     }
 }
 
-int referee(int move1, int move2) {
-    if (move1 == move2) return 0;
-    if ((move1 == 0 && move2 == 1) || (move1 == 1 && move2 == 2) || (move1 == 2 && move2 == 0))
-        return 1;
-    return 2;
+// засыпает на семафоре semnum, пока ready() ложно. Семафор здесь только сигнал пробуждения, а не
+// счетчик событий: перед сном выставляется sleeping, и будящий делает post, только если сам сбросил
+// этот флаг. Если событие пришло между флагом и проверкой, ожидающий пробует сбросить флаг сам, а
+// когда будящий его опередил, забирает уже отправленный post. Так значение семафора не больше 1
+// и не упирается в SEMVMX (32767), сколько бы запросов или ходов ни ждало своей очереди
+template <typename Ready>
+void sleepUntil(int semnum, std::atomic<int>& sleeping, Ready ready) {
+    while (!ready()) {
+        sleeping.store(1);
+        if (ready() && sleeping.exchange(0)) {
+            break;
+        }
+        sem_wait_sysv(semnum);
+    }
+}
+
+// будит ожидающего в sleepUntil(), если он выставил флаг. Событие уже должно быть опубликовано
+void wakeSleeper(int semnum, std::atomic<int>& sleeping) {
+    if (sleeping.exchange(0)) {
+        sem_post_sysv(semnum);
+    }
+}
+
+// сколько семафоров можно создать в одном наборе: SEMMSL из /proc/sys/kernel/sem,
+// но не больше, чем адресует поле sem_num в semop
+int maxSemaphores() {
+    int semmsl = 32000;
+    FILE* file = fopen("/proc/sys/kernel/sem", "r");
+    if (file) {
+        if (fscanf(file, "%d", &semmsl) != 1) {
+            semmsl = 32000;
+        }
+        fclose(file);
+    }
+    return std::min(semmsl, USHRT_MAX + 1);
+}
+
+// выделяет место под массив в сегменте и возвращает его смещение
+size_t placeArray(size_t& size, size_t bytes, size_t align) {
+    size = (size + align - 1) / align * align;
+    size_t offset = size;
+    size += bytes;
+    return offset;
+}
+
+// считает смещения массивов для n игроков и пула из workers воркеров, возвращает полный размер сегмента
+// с padded ячейка каждого игрока занимает свою кэш-линию, а массивы, которые пишет только
+// главный процесс, начинаются с новой линии и не делят ее с ячейками игроков
+size_t layoutState(TournamentState* layout, int n, int workers, bool padded) {
+    size_t size = sizeof(TournamentState);
+    size_t align = padded ? CACHE_LINE : alignof(int);
+    layout->slot_stride = padded ? CACHE_LINE : sizeof(PlayerSlot);
+    layout->workers = workers;
+    // у воркера не больше одного запроса на каждого его игрока, и еще одна ячейка остается пустой,
+    // чтобы полная очередь отличалась от пустой: воркер видит запрос по head != tail
+    layout->request_capacity = workers > 0 ? (n + workers - 1) / workers + 1 : 0;
+    layout->slots_offset = placeArray(size, n * layout->slot_stride, padded ? CACHE_LINE : alignof(PlayerSlot));
+    layout->opponent_offset = placeArray(size, n * sizeof(int), align);
+    layout->ready_offset = placeArray(size, n * sizeof(std::atomic<int>), align);
+    layout->requests_offset = placeArray(size, workers * layout->request_capacity * sizeof(int), align);
+    layout->request_heads_offset = placeArray(size, workers * sizeof(int), alignof(int));
+    layout->request_tails_offset = placeArray(size, workers * sizeof(std::atomic<int>), alignof(int));
+    layout->request_sleeping_offset = placeArray(size, workers * sizeof(std::atomic<int>), alignof(int));
+    return size;
+}
+
+// публикует ход игрока без блокировок: запись в свою ячейку и место в очереди через fetch_add
+void publishMove(int player, int move) {
+    PlayerSlot &slot = tournamentState->slot(player);
+    slot.move = move;
+    slot.seq.store(slot.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+    uint32_t pos = tournamentState->ready_tail.fetch_add(1) % tournamentState->total_players;
+    tournamentState->ready_players()[pos].store(player);
+
+    tourTrace.event(TRACE_MOVE, player);
+    wakeSleeper(SEM_MOVE, tournamentState->referee_sleeping);
+}
+
+// генерирует pipeline ходов подряд и упаковывает их в одно число для ячейки игрока
+int generateMoves(PlayerRng& gen) {
+    int packed = 0;
+    for (int i = 0; i < pipeline; i++) {
+        packed |= nextMove(gen) << (2 * i);
+    }
+    return packed;
 }
 
 void playerProcess(int id) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> distrib(0, 2);
+    tourTrace.attach(id, TRACE_PLAYER, id);
+    PlayerRng gen = playerRng(seed, id - 1);
 
     while (true) {
+        int64_t waitStart = tourStats.clock();
+        tourTrace.event(TRACE_WAIT);
         sem_wait_sysv(SEM_PLAYER_START + id - 1);
-        sem_wait_sysv(SEM_MAIN);
 
-        if (tournamentState->is_finished || !tournamentState->is_in_game[id - 1]) {
-            sem_post_sysv(SEM_MAIN);
+        // is_finished и in_game главный процесс меняет до post семафора игрока,
+        // поэтому после wait их можно читать без SEM_MAIN
+        if (tournamentState->is_finished || !tournamentState->slot(id - 1).in_game) {
+            break;
+        }
+
+        tourStats.playerMoved(id - 1, waitStart);
+        tourTrace.event(TRACE_WAKE, id - 1);
+        publishMove(id - 1, generateMoves(gen));
+    }
+    exit(0);
+}
+
+// воркер пула обслуживает игроков worker, worker + workers, ... из одной точки ожидания
+void workerProcess(int worker) {
+    tourTrace.attach(worker + 1, TRACE_WORKER, worker + 1);
+    // у каждого игрока шарда свой поток случайных чисел, тот же, что и у отдельного процесса игрока
+    std::vector<PlayerRng> gens;
+    for (int player = worker; player < n; player += workers) {
+        gens.push_back(playerRng(seed, player));
+    }
+
+    int *queue = tournamentState->requests(worker);
+    int &head = tournamentState->request_heads()[worker];
+    std::atomic<int> &tail = tournamentState->request_tails()[worker];
+
+    while (true) {
+        int64_t waitStart = tourStats.clock();
+        tourTrace.event(TRACE_WAIT);
+        sleepUntil(SEM_PLAYER_START + worker, tournamentState->request_sleeping()[worker], [&] {
+            return tournamentState->is_finished || tail.load() != head;
+        });
+
+        if (tournamentState->is_finished) {
             break;
         }
 
-        int move = distrib(gen);
-        tournamentState->players_moves[id - 1] = move;
+        // очередь запросов воркера однопоточная с обеих сторон: tail двигает только главный
+        // процесс, head только воркер. Запрос виден воркеру после записи tail
+        int player = queue[head];
+        head = (head + 1) % tournamentState->request_capacity;
 
-        sem_post_sysv(SEM_MAIN);
-        sem_post_sysv(SEM_MOVE);
+        tourStats.playerMoved(player, waitStart);
+        tourTrace.event(TRACE_WAKE, player);
+        publishMove(player, generateMoves(gens[player / workers]));
     }
     exit(0);
 }
 
+// число дочерних процессов: игроков или воркеров пула
+int processCount() {
+    return pool ? workers : n;
+}
+
 void handle_sigint(int sig) {
+    // SIGINT с терминала получает вся группа процессов, ресурсы освобождает только главный
+    if (getpid() != ownerPid) {
+        exit(0);
+    }
     std::cout << "Получен SIGINT, завершаю турнир и очищаю ресурсы..." << std::endl;
-    for (int i = 0; i < n; i++) {
+    if (tournamentState) {
+        tournamentState->is_finished = true;
+    }
+    for (int i = 0; i < processCount(); i++) {
         sem_post_sysv(SEM_PLAYER_START + i);
     }
 
-    for (pid_t pid : playerPids) {
-        waitpid(pid, nullptr, 0);
+    releaseResources(false);
+    exit(0);
+}
+
+// ждет ход любого игрока и возвращает его номер
+int waitForMove() {
+    // место в очереди игрок получает раньше, чем записывает в него свой номер, поэтому
+    // разбудить может и более поздний игрок, пока ячейка в голове очереди еще пуста
+    std::atomic<int> &cell = tournamentState->ready_players()[tournamentState->ready_head];
+    sleepUntil(SEM_MOVE, tournamentState->referee_sleeping, [&] {
+        return cell.load() != -1;
+    });
+    int player = cell.load(std::memory_order_relaxed);
+    cell.store(-1, std::memory_order_relaxed);
+    tournamentState->ready_head = (tournamentState->ready_head + 1) % tournamentState->total_players;
+
+    return player;
+}
+
+// забирает из ячейки игрока ход, который главный процесс еще не видел
+int takeMove(int player) {
+    PlayerSlot &slot = tournamentState->slot(player);
+    uint32_t seq;
+    while ((seq = slot.seq.load(std::memory_order_acquire)) == takenSeq[player]) {
+        sched_yield();
+    }
+    takenSeq[player] = seq;
+    return slot.move;
+}
+
+// транспорт для движка турнира: запрос хода - семафор игрока или очередь его воркера,
+// ход - ячейка игрока и номер в очереди ready_players
+struct SysvTransport : TransportBase<SysvTransport> {
+    int movesPerRequest() const {
+        return pipeline;
     }
 
-    if (semid != -1) {
-        if (semctl(semid, 0, IPC_RMID) == -1) {
-            perror("semctl IPC_RMID");
+    void requestMove(int player) {
+        if (!pool) {
+            sem_post_sysv(SEM_PLAYER_START + player);
+            return;
         }
+
+        int worker = player % workers;
+        std::atomic<int> &tail = tournamentState->request_tails()[worker];
+        int pos = tail.load(std::memory_order_relaxed);
+        tournamentState->requests(worker)[pos] = player;
+        tail.store((pos + 1) % tournamentState->request_capacity);
+
+        wakeSleeper(SEM_PLAYER_START + worker, tournamentState->request_sleeping()[worker]);
     }
 
-    if (tournamentState) {
-        shmdt(tournamentState);
+    PlayerMove collectMove() {
+        int player = waitForMove();
+        return {player, takeMove(player)};
     }
 
-    if (shmid != -1) {
-        shmctl(shmid, IPC_RMID, nullptr);
+    void onRoundStart(int round) {
+        sem_wait_sysv(SEM_MAIN);
+        tournamentState->current_round = round;
+        sem_post_sysv(SEM_MAIN);
     }
 
-    exit(0);
-}
+    void onMatchStart(const Match& m) {
+        sem_wait_sysv(SEM_MAIN);
+        tournamentState->opponent()[m.player1] = m.player2;
+        tournamentState->opponent()[m.player2] = m.player1;
+        sem_post_sysv(SEM_MAIN);
+    }
+
+    void onMatchDecided(int winner, int loser) {
+        sem_wait_sysv(SEM_MAIN);
+        tournamentState->slot(loser).in_game = false;
+        sem_post_sysv(SEM_MAIN);
+    }
+
+    void onFinish(int winner) {
+        sem_wait_sysv(SEM_MAIN);
+        tournamentState->tournament_winner = winner + 1;
+        tournamentState->is_finished = true;
+        sem_post_sysv(SEM_MAIN);
+    }
+
+    void shutdown() {
+        for (int i = 0; i < processCount(); i++) {
+            sem_post_sysv(SEM_PLAYER_START + i);
+        }
+
+        releaseResources(false);
+    }
+};
 
-int main() {
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--concurrent") == 0) {
+            concurrent = true;
+        } else if (strcmp(argv[i], "--dataflow") == 0) {
+            dataflow = true;
+        } else if (strcmp(argv[i], "--players") == 0 && i + 1 < argc) {
+            n = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+            seeded = true;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            benchMode = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            statsEnabled = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+            if (!setLogLevel(argv[++i])) {
+                std::cerr << "Уровень лога: off, rounds, matches или moves" << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--pipeline") == 0 && i + 1 < argc) {
+            pipeline = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--padded") == 0) {
+            padded = true;
+        } else if (strcmp(argv[i], "--pool") == 0) {
+            pool = true;
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            pool = true;
+            workers = atoi(argv[++i]);
+        }
+    }
+
+    ownerPid = getpid();
     struct sigaction sa{};
     sa.sa_handler = handle_sigint;
     sa.sa_flags = 0;
     sigaction(SIGINT, &sa, nullptr);
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> distrib(2, 101);
-    n = distrib(gen);
+    // дочерний процесс, у которого не прошел semop, сообщает об этом сигналом
+    sa.sa_handler = handle_child_failure;
+    sigaction(SIGUSR1, &sa, nullptr);
+
+    if (!seeded) {
+        seed = randomSeed();
+    }
+    if (n == 0) {
+        n = playersFromSeed(seed);
+    }
+    if (n < 2) {
+        std::cerr << "Количество игроков должно быть не меньше 2" << std::endl;
+        return 1;
+    }
+    if (pipeline < 1 || pipeline > MAX_PIPELINE) {
+        std::cerr << "Число ходов за запрос должно быть от 1 до " << MAX_PIPELINE << std::endl;
+        return 1;
+    }
     std::cout << "Количество игроков в турнире: " << n << std::endl;
+    std::cout << "Сид турнира: " << seed << std::endl;
+
+    // сегмент метрик создается до fork, чтобы игроки унаследовали его отображение
+    if (statsEnabled) {
+        if (!tourStats.create(n, "main_sysv")) {
+            return 1;
+        }
+        std::cout << "Метрики: ./tourtop " << getpid() << std::endl;
+    }
+
+    if (pool) {
+        // по умолчанию по одному воркеру на ядро
+        if (workers <= 0) {
+            workers = sysconf(_SC_NPROCESSORS_ONLN);
+        }
+        workers = std::max(1, std::min(workers, n));
+        std::cout << "Игроков обслуживает пул из " << workers << " воркеров" << std::endl;
+    }
 
-    shmid = shmget(IPC_PRIVATE, sizeof(TournamentState), IPC_CREAT | 0666);
+    // без пула у каждого игрока свой семафор в наборе, и набор не может быть больше SEMMSL
+    int totalSems = SEM_PLAYER_START + processCount();
+    if (totalSems > maxSemaphores()) {
+        if (pool) {
+            std::cerr << "Воркерам нужно " << totalSems << " семафоров, а в наборе помещается "
+                      << maxSemaphores() << " (SEMMSL): уменьшите --workers" << std::endl;
+        } else {
+            std::cerr << "Без --pool каждому игроку нужен свой семафор: " << totalSems
+                      << " семафоров, а в наборе помещается " << maxSemaphores()
+                      << " (SEMMSL). Запустите с --pool" << std::endl;
+        }
+        return 1;
+    }
+
+    // буферы трассы, как и метрики, выделяются до fork: буфер 0 - судья, дальше игроки или воркеры
+    if (traceFile && !tourTrace.create(pool ? workers : n, traceFile)) {
+        return 1;
+    }
+
+    TournamentState layout{};
+    shmSize = layoutState(&layout, n, pool ? workers : 0, padded);
+    shmid = shmget(IPC_PRIVATE, shmSize, IPC_CREAT | 0666);
 
     if (shmid < 0) {
         perror("shmget"); 
@@ -149,15 +547,18 @@ int main() {
 
     if (tournamentState == reinterpret_cast<TournamentState*>(-1)) {
         perror("shmat"); 
+        tournamentState = nullptr;
+        releaseResources(true);
         return 1; 
     }
 
-    memset(tournamentState, 0, sizeof(TournamentState));
+    memset(static_cast<void*>(tournamentState), 0, shmSize);
+    layoutState(tournamentState, n, pool ? workers : 0, padded);
    
-    int totalSems = SEM_PLAYER_START + n;
     semid = semget(IPC_PRIVATE, totalSems, IPC_CREAT | 0666);
     if (semid < 0) {
         perror("semget");
+        releaseResources(true);
         return 1;
     }
 
@@ -166,19 +567,22 @@ int main() {
     arg.val = 1;
     if (semctl(semid, SEM_MAIN, SETVAL, arg) == -1) {
         perror("semctl main");
+        releaseResources(true);
         return 1;
     }
     
     arg.val = 0;
     if (semctl(semid, SEM_MOVE, SETVAL, arg) == -1) {
         perror("semctl move");
+        releaseResources(true);
         return 1;
     }
 
-    for (int i = 0; i < n; i++) {
+    for (int i = 0; i < processCount(); i++) {
         arg.val = 0;
         if (semctl(semid, SEM_PLAYER_START + i, SETVAL, arg) == -1) {
             perror("semctl player");
+            releaseResources(true);
             return 1;
         }
     }
@@ -188,145 +592,38 @@ int main() {
     tournamentState->is_finished = false;
     tournamentState->current_round = 1;
 
+    takenSeq.assign(n, 0);
     for (int i = 0; i < n; i++) {
-        tournamentState->is_in_game[i] = true;
-        tournamentState->opponent[i] = -1;
+        tournamentState->slot(i).in_game = true;
+        tournamentState->opponent()[i] = -1;
+        tournamentState->ready_players()[i].store(-1);
     }
 
-    for (int i = 0; i < n; i++) {
+    for (int i = 0; i < processCount(); i++) {
         pid_t pid = fork();
 
         if (pid < 0) { 
             perror("fork"); 
+            releaseResources(true);
             return 1; 
         }
 
         if (pid == 0) {
-            playerProcess(i + 1);
+            if (pool) {
+                workerProcess(i);
+            } else {
+                playerProcess(i + 1);
+            }
         }
         
         playerPids.push_back(pid);
     }
 
-    int numRounds = static_cast<int>(std::ceil(std::log2(n)));
-
-    std::vector<int> activeStudents(n);
-    for (int i = 0; i < n; i++) {
-        activeStudents[i] = i;
-    }
-
-    for (int round = 1; round <= numRounds; round++) {
-        std::cout << "\nРаунд " << round << std::endl;
-        tournamentState->winners_count = 0;
-
-        sem_wait_sysv(SEM_MAIN);
-        tournamentState->current_round = round;
-        sem_post_sysv(SEM_MAIN);
-
-        int matchCount = activeStudents.size() / 2;
-
-        if (activeStudents.size() % 2 == 1) {
-            int idx = activeStudents.back();
-            std::cout << "Студент " << idx + 1 << " проходит в следующий раунд" << std::endl;
-
-            sem_wait_sysv(SEM_MAIN);
-            tournamentState->round_winners[tournamentState->winners_count++] = idx;
-            sem_post_sysv(SEM_MAIN);
-        }
-
-        for (int m = 0; m < matchCount; m++) {
-            int p1 = activeStudents[2 * m];
-            int p2 = activeStudents[2 * m + 1];
-            std::cout << "Матч между " << p1 + 1 << " и " << p2 + 1 << std::endl;
-
-            sem_wait_sysv(SEM_MAIN);
-            tournamentState->opponent[p1] = p2;
-            tournamentState->opponent[p2] = p1;
-            sem_post_sysv(SEM_MAIN);
-
-            sem_post_sysv(SEM_PLAYER_START + p1);
-            sem_post_sysv(SEM_PLAYER_START + p2);
-
-            bool decided = false;
-            while (!decided) {
-                sem_wait_sysv(SEM_MOVE);
-                sem_wait_sysv(SEM_MOVE);
-
-                sem_wait_sysv(SEM_MAIN);
-                int c1 = tournamentState->players_moves[p1];
-                int c2 = tournamentState->players_moves[p2];
-                sem_post_sysv(SEM_MAIN);
-
-                std::cout << "   Игрок " << p1 + 1 << " выбрал " << moves[c1] << std::endl;
-                std::cout << "   Игрок " << p2 + 1 << " выбрал " << moves[c2] << std::endl;
-
-                int res = referee(c1, c2);
-                
-                if (res == 1) {
-                    std::cout << "  Игрок " << p1+1 << " победил" << std::endl;
-                    sem_wait_sysv(SEM_MAIN);
-                    tournamentState->is_in_game[p2] = false;
-                    tournamentState->round_winners[tournamentState->winners_count++] = p1;
-                    sem_post_sysv(SEM_MAIN);
-                    decided = true;
-                } else if (res == 2) {
-                    std::cout << "  Игрок " << p2+1 << " победил" << std::endl;
-                    sem_wait_sysv(SEM_MAIN);
-                    tournamentState->is_in_game[p1] = false;
-                    tournamentState->round_winners[tournamentState->winners_count++] = p2;
-                    sem_post_sysv(SEM_MAIN);
-                    decided = true;
-                } else {
-                    std::cout << "  Ничья, матч переигрывается..." << std::endl;
-                    sem_post_sysv(SEM_PLAYER_START + p1);
-                    sem_post_sysv(SEM_PLAYER_START + p2);
-                }
-            }
-        }
-
-        activeStudents.clear();
-
-        sem_wait_sysv(SEM_MAIN);
-        for (int i = 0; i < tournamentState->winners_count; i++) {
-            activeStudents.push_back(tournamentState->round_winners[i]);
-        }
-        sem_post_sysv(SEM_MAIN);
-
-        if (activeStudents.size() == 1) {
-            sem_wait_sysv(SEM_MAIN);
-            tournamentState->tournament_winner = activeStudents[0] + 1;
-            tournamentState->is_finished = true;
-            sem_post_sysv(SEM_MAIN);
-
-            std::cout << "\nТурнир закончен, выиграл игрок под номером: " << tournamentState->tournament_winner << std::endl;
-            break;
-        }
-    }
-
-    for (int i = 0; i < n; i++) {
-        sem_post_sysv(SEM_PLAYER_START + i);
-    }
-
-    for (pid_t pid : playerPids) {
-        if (waitpid(pid, nullptr, 0) == -1) {
-            perror("waitpid");
-        }
-    }
+    SysvTransport transport;
+    Tournament<SysvTransport> tournament(transport, n, concurrent, dataflow);
+    tournament.run();
 
-    if (semid != -1) {
-        if (semctl(semid, 0, IPC_RMID) == -1) {
-            perror("semctl IPC_RMID");
-        }
-    }
-    if (tournamentState) {
-        if (shmdt(tournamentState) == -1) {
-            perror("shmdt");
-        }
-    }
-    if (shmid != -1) {
-        if (shmctl(shmid, IPC_RMID, nullptr) == -1) {
-            perror("shmctl IPC_RMID");
-        }
-    }
+    transport.shutdown();
+    benchReport();
     return 0;
 } 
\ No newline at end of file
@@ -1,6 +1,5 @@
 #include <iostream>
 #include <vector>
-#include <random>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <sys/types.h>
@@ -11,6 +10,15 @@
 #include <cmath>
 #include <signal.h>
 #include <string>
+#include <deque>
+#include <algorithm>
+#include <cerrno>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+#include "tournament.h"
+#include "rng.h"
 
 union semun {
     int val;
@@ -21,17 +29,44 @@ union semun {
 #define SEM_MAIN 0
 #define SEM_PLAYER_START 1
 
+// ходы для шарда судьи s идут с типом MOVE_MTYPE + s, за ними идут типы запросов хода (см. requestMtype)
+#define MOVE_MTYPE 1
+
 struct MoveMsg {
     long mtype;
     int player_id;
     int move;
+    int shard;      // шард судьи, который ведет матч игрока; в запросе - куда отправить ход
 };
 
 int semid = -1;
 int msqid = -1;
 std::vector<pid_t> playerPids;
 int n;
-std::string moves[3] = {"камень", "ножницы", "бумага"};
+bool concurrent = false;
+bool dataflow = false;  // --dataflow: сетка без барьера между раундами
+bool pool = false;
+int workers = 0;
+uint64_t seed = 0;      // сид турнира, без --seed выбирается случайно
+bool seeded = false;
+bool statsEnabled = false; // --stats: живые метрики для tourtop
+const char* traceFile = nullptr; // --trace FILE: трасса событий для chrome://tracing
+int shards = 1;
+int stealWindow = 0;  // --steal W: шарды перехватывают друг у друга матчи, у шарда в полете до W матчей
+std::deque<MoveMsg> pendingRequests; // запросы, не поместившиеся в очередь
+std::mutex requestsMutex;
+std::atomic<int> requestsInFlight{0}; // запросы в очереди, ответ на которые еще не прочитан
+int maxRequestsInFlight = 0;
+
+// тип сообщения с ходом для шарда судьи
+long moveMtype(int shard) {
+    return MOVE_MTYPE + shard;
+}
+
+// тип сообщения с запросом хода воркеру пула или, при нескольких шардах, игроку
+long requestMtype(int target) {
+    return MOVE_MTYPE + shards + target;
+}
 
 // функция wait для семафора system v
 void sem_wait_sysv(int semnum) {
@@ -59,30 +94,40 @@ void sem_post_sysv(int semnum) {
     }
 }
 
-int referee(int move1, int move2) {
-    if (move1 == move2) {
-        return 0;
-    } else if (move1 == 0 && move2 == 1 || move1 == 1 && move2 == 2 || move1 == 2 && move2 == 0) {
-        return 1;
-    }
-    return 2;
-}
-
 void playerProcess(int id) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> distrib(0, 2);
+    tourTrace.attach(id, TRACE_PLAYER, id);
+    PlayerRng gen = playerRng(seed, id - 1);
 
     while (true) {
-        sem_wait_sysv(SEM_PLAYER_START + id - 1);
+        // с одним шардом ход всегда идет с MOVE_MTYPE и игроку достаточно семафора,
+        // иначе он узнает шард своего матча из запроса
+        int64_t waitStart = tourStats.clock();
+        tourTrace.event(TRACE_WAIT);
+        int shard = 0;
+        if (shards > 1) {
+            MoveMsg request;
+            if (msgrcv(msqid, &request, sizeof(request) - sizeof(long), requestMtype(id - 1), 0) == -1) {
+                perror("msgrcv");
+                exit(1);
+            }
+            shard = request.shard;
+        } else {
+            sem_wait_sysv(SEM_PLAYER_START + id - 1);
+        }
+        tourTrace.event(TRACE_LOCK);
         sem_wait_sysv(SEM_MAIN);
+        tourTrace.event(TRACE_LOCKED);
+        tourStats.playerMoved(id - 1, waitStart);
+        tourTrace.event(TRACE_WAKE, id - 1);
 
-        int move = distrib(gen);
+        int move = nextMove(gen);
         MoveMsg msg;
-        msg.mtype = 1;
+        msg.mtype = moveMtype(shard);
         msg.player_id = id - 1;
         msg.move = move;
+        msg.shard = shard;
 
+        tourTrace.event(TRACE_MOVE, id - 1);
         if (msgsnd(msqid, &msg, sizeof(msg) - sizeof(long), 0) == -1) {
             perror("msgsnd");
             exit(1);
@@ -93,7 +138,44 @@ void playerProcess(int id) {
     exit(0);
 }
 
-void cleanup() {
+// воркер пула обслуживает игроков worker, worker + workers, ... читая из очереди только свои запросы
+void workerProcess(int worker) {
+    tourTrace.attach(worker + 1, TRACE_WORKER, worker + 1);
+    // у каждого игрока шарда свой поток случайных чисел, тот же, что и у отдельного процесса игрока
+    std::vector<PlayerRng> gens;
+    for (int player = worker; player < n; player += workers) {
+        gens.push_back(playerRng(seed, player));
+    }
+
+    while (true) {
+        MoveMsg request;
+        int64_t waitStart = tourStats.clock();
+        tourTrace.event(TRACE_WAIT);
+        if (msgrcv(msqid, &request, sizeof(request) - sizeof(long), requestMtype(worker), 0) == -1) {
+            perror("msgrcv");
+            exit(1);
+        }
+
+        int player = request.player_id;
+        tourStats.playerMoved(player, waitStart);
+        tourTrace.event(TRACE_WAKE, player);
+        MoveMsg msg;
+        msg.mtype = moveMtype(request.shard);
+        msg.player_id = player;
+        msg.move = nextMove(gens[player / workers]);
+        msg.shard = request.shard;
+
+        tourTrace.event(TRACE_MOVE, player);
+        if (msgsnd(msqid, &msg, sizeof(msg) - sizeof(long), 0) == -1) {
+            perror("msgsnd");
+            exit(1);
+        }
+    }
+    exit(0);
+}
+
+// будит и дожидается дочерние процессы, удаляет очереди и семафоры
+void releaseResources() {
     for (pid_t pid : playerPids) {
         kill(pid, SIGTERM);
     }
@@ -109,7 +191,10 @@ void cleanup() {
     if (msqid != -1) {
         msgctl(msqid, IPC_RMID, nullptr);
     }
+}
 
+void cleanup() {
+    releaseResources();
     exit(0);
 }
 
@@ -118,18 +203,234 @@ void handle_sigint(int sig) {
     cleanup();
 }
 
-int main() {
+// отправляет накопленные запросы. Отправка неблокирующая: если главный процесс заблокируется
+// на переполненной очереди, игроки и воркеры не смогут отдать ему ходы. Очередь у всех одна,
+// поэтому после первого EAGAIN дальше пробовать бесполезно.
+// Запросов без ответа не больше, чем помещается в очередь: иначе запросы могут занять ее целиком,
+// и воркер навсегда заблокируется на отправке хода, который главный процесс ждет
+void flushRequests() {
+    std::lock_guard<std::mutex> lock(requestsMutex);
+    while (!pendingRequests.empty() && requestsInFlight.load() < maxRequestsInFlight) {
+        MoveMsg &request = pendingRequests.front();
+        if (msgsnd(msqid, &request, sizeof(request) - sizeof(long), IPC_NOWAIT) == -1) {
+            if (errno == EAGAIN) {
+                return;
+            }
+            perror("msgsnd");
+            cleanup();
+        }
+        requestsInFlight++;
+        pendingRequests.pop_front();
+    }
+}
+
+// просит игрока сделать ход: напрямую через его семафор или запросом в очереди,
+// если игроку нужно сообщить шард (несколько шардов) или ход делает его воркер
+void requestMove(int player, int shard) {
+    if (!pool && shards == 1) {
+        sem_post_sysv(SEM_PLAYER_START + player);
+        return;
+    }
+
+    MoveMsg request;
+    request.mtype = requestMtype(pool ? player % workers : player);
+    request.player_id = player;
+    request.move = -1;
+    request.shard = shard;
+
+    std::lock_guard<std::mutex> lock(requestsMutex);
+    pendingRequests.push_back(request);
+}
+
+// транспорт для движка турнира. Каждый шард судьи работает через свою копию транспорта:
+// запросы несут номер шарда, а ходы шарда приходят со своим mtype
+struct SysvMqTransport : TransportBase<SysvMqTransport> {
+    int shard = 0;
+
+    void requestMove(int player) {
+        ::requestMove(player, shard);
+    }
+
+    PlayerMove collectMove() {
+        if (pool || shards > 1) {
+            flushRequests();
+        }
+
+        MoveMsg msg;
+        // Так как процесс получения блокирующий, то мы можем получить сообщение без семафоров
+        if (msgrcv(msqid, &msg, sizeof(msg) - sizeof(long), moveMtype(shard), 0) == -1) {
+            perror("msgrcv");
+            cleanup();
+        }
+        if (pool || shards > 1) {
+            // место освободилось: досылаем запросы, иначе их может ждать шард, который уже спит в msgrcv
+            requestsInFlight--;
+            flushRequests();
+        }
+        return {msg.player_id, msg.move};
+    }
+
+    // шард судьи ведет матчи с номерами shard, shard + shards, ... и выбирает из очереди
+    // только сообщения своего типа, поэтому шарды не мешают друг другу
+    template <typename Engine>
+    void playRound(Engine& engine, std::vector<Match>& matches, int winnersOffset) {
+        if (shards == 1) {
+            engine.playMatches(*this, matches, winnersOffset);
+            return;
+        }
+
+        std::vector<std::thread> referees;
+        for (int shard = 0; shard < shards; shard++) {
+            referees.emplace_back([&engine, &matches, winnersOffset, shard]() {
+                traceThread = shard + 1; // в трассе каждый шард - отдельная дорожка судьи
+                SysvMqTransport channel;
+                channel.shard = shard;
+                engine.playMatches(channel, matches, winnersOffset, shard, shards);
+            });
+        }
+        for (std::thread &t : referees) {
+            t.join();
+        }
+    }
+
+    // с --dataflow шарды делят сетку: шард ведет матчи своего отрезка игроков до конца, без
+    // барьеров между раундами, а матчи между отрезками потом доигрывает основной поток
+    template <typename Engine>
+    void playBracket(Engine& engine) {
+        if (shards == 1) {
+            engine.playOwned(*this, 0);
+            return;
+        }
+
+        if (stealWindow > 0) {
+            playShared(engine);
+            return;
+        }
+
+        engine.splitBracket(shards);
+        std::vector<std::thread> referees;
+        for (int shard = 0; shard < shards; shard++) {
+            referees.emplace_back([&engine, shard]() {
+                traceThread = shard + 1;
+                SysvMqTransport channel;
+                channel.shard = shard;
+                engine.playOwned(channel, shard);
+            });
+        }
+        for (std::thread &t : referees) {
+            t.join();
+        }
+        engine.playOwned(*this, shards);
+    }
+
+    // с --steal у шардов нет закрепленных матчей: готовые матчи и переигровки лежат в очередях
+    // шардов, и шард без работы забирает их у соседей
+    template <typename Engine>
+    void playShared(Engine& engine) {
+        engine.shareBracket(shards, stealWindow);
+        std::vector<std::thread> referees;
+        for (int shard = 0; shard < shards; shard++) {
+            referees.emplace_back([&engine, shard]() {
+                traceThread = shard + 1;
+                SysvMqTransport channel;
+                channel.shard = shard;
+                engine.playShared(channel, shard);
+            });
+        }
+        for (std::thread &t : referees) {
+            t.join();
+        }
+    }
+
+    void shutdown() {
+        releaseResources();
+    }
+};
+
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--concurrent") == 0) {
+            concurrent = true;
+        } else if (strcmp(argv[i], "--dataflow") == 0) {
+            dataflow = true;
+        } else if (strcmp(argv[i], "--players") == 0 && i + 1 < argc) {
+            n = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+            seeded = true;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            benchMode = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            statsEnabled = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+            if (!setLogLevel(argv[++i])) {
+                std::cerr << "Уровень лога: off, rounds, matches или moves" << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            shards = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--steal") == 0 && i + 1 < argc) {
+            stealWindow = atoi(argv[++i]);
+            dataflow = true;
+        } else if (strcmp(argv[i], "--pool") == 0) {
+            pool = true;
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            pool = true;
+            workers = atoi(argv[++i]);
+        }
+    }
+
     struct sigaction sa{};
     sa.sa_handler = handle_sigint;
     sigaction(SIGINT, &sa, nullptr);
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> distribPlayers(2, 101);
-    n = distribPlayers(gen);
+    if (!seeded) {
+        seed = randomSeed();
+    }
+    if (n == 0) {
+        n = playersFromSeed(seed);
+    }
+    if (n < 2) {
+        std::cerr << "Количество игроков должно быть не меньше 2" << std::endl;
+        return 1;
+    }
     std::cout << "Количество игроков в турнире: " << n << std::endl;
+    std::cout << "Сид турнира: " << seed << std::endl;
 
-    int totalSems = SEM_PLAYER_START + n;
+    // сегмент метрик создается до fork, чтобы игроки унаследовали его отображение
+    if (statsEnabled) {
+        if (!tourStats.create(n, "main_sysv_mq")) {
+            return 1;
+        }
+        std::cout << "Метрики: ./tourtop " << getpid() << std::endl;
+    }
+
+    if (pool) {
+        // по умолчанию по одному воркеру на ядро
+        if (workers <= 0) {
+            workers = sysconf(_SC_NPROCESSORS_ONLN);
+        }
+        workers = std::max(1, std::min(workers, n));
+        std::cout << "Игроков обслуживает пул из " << workers << " воркеров" << std::endl;
+    }
+
+    // буферы трассы, как и метрики, выделяются до fork: буфер 0 - судья, дальше игроки или воркеры
+    if (traceFile && !tourTrace.create(pool ? workers : n, traceFile)) {
+        return 1;
+    }
+
+    // больше шардов, чем матчей в первом раунде, не нужно
+    shards = std::max(1, std::min(shards, n / 2));
+    if (shards > 1) {
+        std::cout << "Матчи ведут " << shards << " шардов судьи" << std::endl;
+    }
+    tourStats.setRefereeThreads(shards);
+
+    // семафоры игроков нужны только когда запросы хода не идут через очередь сообщений
+    int playerSemsCount = pool || shards > 1 ? 0 : n;
+    int totalSems = SEM_PLAYER_START + playerSemsCount;
     semid = semget(IPC_PRIVATE, totalSems, IPC_CREAT | 0666);
     if (semid < 0) { 
         perror("semget");
@@ -140,7 +441,7 @@ int main() {
     arg.val = 1;
     semctl(semid, SEM_MAIN, SETVAL, arg);
 
-    for (int i = 0; i < n; i++) {
+    for (int i = 0; i < playerSemsCount; i++) {
         arg.val = 0;
         semctl(semid, SEM_PLAYER_START + i, SETVAL, arg);
     }
@@ -151,14 +452,14 @@ int main() {
         return 1;
     }
 
-    std::vector<bool> is_in_game(n, true);
-    std::vector<int> opponent(n, -1);
-    std::vector<int> round_winners(n);
-
-    int winners_count = 0;
-    int tournament_winner = -1;
+    struct msqid_ds queueInfo{};
+    if (msgctl(msqid, IPC_STAT, &queueInfo) == -1) {
+        perror("msgctl");
+        cleanup();
+    }
+    maxRequestsInFlight = std::max<long>(1, queueInfo.msg_qbytes / (sizeof(MoveMsg) - sizeof(long)));
 
-    for (int i = 0; i < n; i++) {
+    for (int i = 0; i < (pool ? workers : n); i++) {
         pid_t pid = fork();
 
         if (pid < 0) {
@@ -168,86 +469,24 @@ int main() {
 
         if (pid == 0) {
             signal(SIGINT, SIG_DFL);
-            playerProcess(i + 1);
+            if (pool) {
+                workerProcess(i);
+            } else {
+                playerProcess(i + 1);
+            }
         }
 
         playerPids.push_back(pid);
     }
 
-    int numRounds = static_cast<int>(std::ceil(std::log2(n)));
-    std::vector<int> activeStudents(n);
-    for (int i = 0; i < n; i++) activeStudents[i] = i;
-
-    for (int round = 1; round <= numRounds; round++) {
-        std::cout << "\nРаунд " << round << std::endl;
-        winners_count = 0;
-
-        if (activeStudents.size() % 2 == 1) {
-            int idx = activeStudents.back();
-            activeStudents.pop_back();
-            std::cout << "Студент " << idx + 1 << " проходит в следующий раунд" << std::endl;
-            round_winners[winners_count++] = idx;
-        }
-
-        int matchCount = activeStudents.size() / 2;
-        for (int m = 0; m < matchCount; m++) {
-            int p1 = activeStudents[2 * m];
-            int p2 = activeStudents[2 * m + 1];
-            std::cout << "Матч между " << p1 + 1 << " и " << p2 + 1 << std::endl;
-
-            sem_post_sysv(SEM_PLAYER_START + p1);
-            sem_post_sysv(SEM_PLAYER_START + p2);
-
-            bool decided = false;
-            while (!decided) {
-
-                MoveMsg msg1, msg2;
-                // Так как процесс получения блокирующий, то мы можем получить оба сообщения без семафоров
-                if (msgrcv(msqid, &msg1, sizeof(msg1) - sizeof(long), 0, 0) == -1) {
-                    perror("msgrcv");
-                    cleanup();
-                }
-                if (msgrcv(msqid, &msg2, sizeof(msg2) - sizeof(long), 0, 0) == -1) {
-                    perror("msgrcv");
-                    cleanup();
-                }
-
-                int c1 = msg1.move;
-                int c2 = msg2.move;
-                std::cout << "   Игрок " << msg1.player_id + 1 << " выбрал " << moves[c1] << std::endl;
-                std::cout << "   Игрок " << msg2.player_id + 1 << " выбрал " << moves[c2] << std::endl;
-
-                int res = referee(c1, c2);
-                if (res == 1) {
-                    std::cout << "  Игрок " << msg1.player_id + 1 << " победил" << std::endl;
-                    is_in_game[p2] = false;
-                    round_winners[winners_count++] = p1;
-                    decided = true;
-                } else if (res == 2) {
-                    std::cout << "  Игрок " << msg2.player_id + 1 << " победил" << std::endl;
-                    is_in_game[p1] = false;
-                    round_winners[winners_count++] = p2;
-                    decided = true;
-                } else {
-                    std::cout << "  Ничья, матч переигрывается..." << std::endl;
-                    sem_post_sysv(SEM_PLAYER_START + p1);
-                    sem_post_sysv(SEM_PLAYER_START + p2);
-                }
-            }
-        }
-
-        activeStudents.clear();
-        for (int i = 0; i < winners_count; i++) {
-            activeStudents.push_back(round_winners[i]);
-        }
-
-        if (activeStudents.size() == 1) {
-            tournament_winner = activeStudents[0] + 1;
-            std::cout << "\nТурнир закончен, выиграл игрок под номером: " << tournament_winner << std::endl;
-            break;
-        }
+    SysvMqTransport transport;
+    Tournament<SysvMqTransport> tournament(transport, n, concurrent, dataflow);
+    tournament.run();
+    if (stealWindow > 0) {
+        std::cout << "Матчей перехвачено у других шардов: " << tournament.stolenMatches() << std::endl;
     }
 
-    cleanup();
+    transport.shutdown();
+    benchReport();
     return 0;
-} 
\ No newline at end of file
+}
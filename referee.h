@@ -0,0 +1,98 @@
+#ifndef REFEREE_H
+#define REFEREE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Судья общий для всех вариантов. Ходы: 0 - камень, 1 - ножницы, 2 - бумага.
+// Результат: 0 - ничья, 1 - победил первый, 2 - победил второй.
+// Первый побеждает ровно тогда, когда второй ход "следующий" по кругу, поэтому
+// результат равен (move2 - move1) mod 3, и его можно считать без ветвлений.
+inline int referee(int move1, int move2) {
+    return (move2 - move1 + 3) % 3;
+}
+
+// Пакетный судья для целого раунда: left[i] и right[i] - ходы левого и правого игрока i-го матча.
+// Пишет результат каждого матча в results и номера матчей с ничьей, которые нужно переиграть,
+// по возрастанию в draws. Возвращает число ничьих.
+inline size_t refereeBatchScalar(const uint8_t* left, const uint8_t* right, uint8_t* results,
+                                 size_t count, uint32_t* draws, size_t from = 0) {
+    size_t drawCount = 0;
+    for (size_t i = from; i < count; i++) {
+        results[i] = static_cast<uint8_t>(referee(left[i], right[i]));
+        draws[drawCount] = static_cast<uint32_t>(i);
+        drawCount += results[i] == 0;
+    }
+    return drawCount;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// (right + 3 - left) лежит в [1, 5]; mod 3 без деления: min(t, t - 3) в беззнаковой арифметике,
+// при t < 3 разность переполняется и min оставляет t
+__attribute__((target("avx2")))
+inline size_t refereeBatchAvx2(const uint8_t* left, const uint8_t* right, uint8_t* results,
+                               size_t count, uint32_t* draws) {
+    const __m256i three = _mm256_set1_epi8(3);
+    const __m256i zero = _mm256_setzero_si256();
+    size_t drawCount = 0;
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(left + i));
+        __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(right + i));
+        __m256i t = _mm256_sub_epi8(_mm256_add_epi8(r, three), l);
+        __m256i res = _mm256_min_epu8(t, _mm256_sub_epi8(t, three));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(results + i), res);
+
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(res, zero)));
+        while (mask) {
+            draws[drawCount++] = static_cast<uint32_t>(i + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+    return drawCount + refereeBatchScalar(left, right, results, count, draws + drawCount, i);
+}
+
+inline size_t refereeBatchSse2(const uint8_t* left, const uint8_t* right, uint8_t* results,
+                               size_t count, uint32_t* draws) {
+    const __m128i three = _mm_set1_epi8(3);
+    const __m128i zero = _mm_setzero_si128();
+    size_t drawCount = 0;
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i));
+        __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + i));
+        __m128i t = _mm_sub_epi8(_mm_add_epi8(r, three), l);
+        __m128i res = _mm_min_epu8(t, _mm_sub_epi8(t, three));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(results + i), res);
+
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(res, zero)));
+        while (mask) {
+            draws[drawCount++] = static_cast<uint32_t>(i + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+    return drawCount + refereeBatchScalar(left, right, results, count, draws + drawCount, i);
+}
+
+#endif
+
+// выбирает самую широкую версию, которую поддерживает процессор
+inline size_t refereeBatch(const uint8_t* left, const uint8_t* right, uint8_t* results,
+                           size_t count, uint32_t* draws) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2")) {
+        return refereeBatchAvx2(left, right, results, count, draws);
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return refereeBatchSse2(left, right, results, count, draws);
+    }
+#endif
+    return refereeBatchScalar(left, right, results, count, draws);
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+#include <random>
+
+// Генератор ходов, общий для всех вариантов. Каждый игрок получает свой поток, который
+// зависит только от сида турнира и номера игрока, поэтому при одном и том же --seed
+// сетка и последовательности ходов совпадают во всех вариантах и режимах.
+
+// splitmix64: перемешивает 64-битное состояние, используется для заполнения состояния xoshiro
+inline uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// xoshiro256**: 32 байта состояния вместо 5 КБ у mt19937 и несколько тактов на число
+struct PlayerRng {
+    using result_type = uint64_t;
+
+    uint64_t s[4];
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    result_type operator()() {
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+};
+
+// поток игрока player для сида seed; player = -1 - поток самого турнира.
+// Сид и номер сначала перемешиваются, чтобы потоки соседних игроков не были сдвигом друг друга
+inline PlayerRng playerRng(uint64_t seed, int player) {
+    uint64_t state = seed;
+    state = splitmix64(state) ^ (static_cast<uint64_t>(player + 1) * 0xD1B54A32D192ED03ULL);
+
+    PlayerRng rng;
+    for (uint64_t& word : rng.s) {
+        word = splitmix64(state);
+    }
+    return rng;
+}
+
+// равномерное число из [0, range) умножением вместо деления; результат не зависит
+// от реализации std::uniform_int_distribution, поэтому одинаков у всех сборок
+inline int nextBelow(PlayerRng& rng, uint32_t range) {
+    return static_cast<int>(((rng() >> 32) * range) >> 32);
+}
+
+// ход игрока: 0 - камень, 1 - ножницы, 2 - бумага
+inline int nextMove(PlayerRng& rng) {
+    return nextBelow(rng, 3);
+}
+
+// число игроков от 2 до 100 берется из потока турнира
+inline int playersFromSeed(uint64_t seed) {
+    PlayerRng rng = playerRng(seed, -1);
+    return 2 + nextBelow(rng, 99);
+}
+
+// сид для запуска без --seed; печатается, чтобы запуск можно было повторить
+inline uint64_t randomSeed() {
+    std::random_device rd;
+    return (static_cast<uint64_t>(rd()) << 32) | rd();
+}
+
+#endif
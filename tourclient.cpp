@@ -0,0 +1,109 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Клиент сервера турниров (tourserver.cpp): ./tourclient [--socket PATH] [--count K] [--parallel P]
+// [--players N] [--seed S] [--concurrent] [--dataflow]. Открывает P соединений, и по каждому
+// подряд просит K турниров. Сиды идут подряд от S, так что все турниры разные и воспроизводимые.
+// Печатает ответ сервера на каждый турнир и общее число турниров в секунду.
+
+const char* socketPath = "/tmp/tourserver.sock";
+int count = 1;
+int parallel = 1;
+uint64_t seed = 1;
+std::string options;    // флаги турнира, которые передаются серверу как есть
+std::mutex outputMutex;
+bool failed = false;
+
+// одна строка ответа сервера
+bool readLine(int fd, std::string& buffer, std::string& line) {
+    char chunk[4096];
+    size_t newline;
+    while ((newline = buffer.find('\n')) == std::string::npos) {
+        ssize_t got = read(fd, chunk, sizeof(chunk));
+        if (got <= 0) {
+            return false;
+        }
+        buffer.append(chunk, got);
+    }
+    line = buffer.substr(0, newline);
+    buffer.erase(0, newline + 1);
+    return true;
+}
+
+void connection(int index) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath, sizeof(addr.sun_path) - 1);
+    if (fd == -1 || connect(fd, (struct sockaddr*) &addr, sizeof(addr)) == -1) {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        perror(("connect " + std::string(socketPath) + " (сервер запущен?)").c_str());
+        failed = true;
+        return;
+    }
+
+    std::string buffer;
+    for (int i = 0; i < count; i++) {
+        std::string request = options + " --seed " + std::to_string(seed + static_cast<uint64_t>(index) * count + i) + "\n";
+        std::string reply;
+        if (write(fd, request.data(), request.size()) != static_cast<ssize_t>(request.size()) ||
+            !readLine(fd, buffer, reply)) {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cerr << "Сервер закрыл соединение" << std::endl;
+            failed = true;
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(outputMutex);
+        std::cout << reply << std::endl;
+        failed |= reply.compare(0, 6, "error:") == 0;
+    }
+    close(fd);
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--parallel") == 0 && i + 1 < argc) {
+            parallel = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--players") == 0 && i + 1 < argc) {
+            options += " --players " + std::string(argv[++i]);
+        } else if (strcmp(argv[i], "--concurrent") == 0 || strcmp(argv[i], "--dataflow") == 0) {
+            options += " " + std::string(argv[i]);
+        }
+    }
+
+    if (count < 1 || parallel < 1) {
+        std::cerr << "Число турниров и соединений должно быть положительным" << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < parallel; i++) {
+        threads.emplace_back(connection, i);
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    long total = static_cast<long>(count) * parallel;
+    std::cout << "Турниров: " << total << " за " << seconds * 1000 << " мс, в секунду: "
+              << static_cast<long>(total / seconds) << std::endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,300 @@
+#ifndef TOURLOG_H
+#define TOURLOG_H
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+// Лог турнира, общий для всех вариантов. Судья не печатает сам: он кладет короткие записи
+// в заранее выделенное кольцо, а фоновый поток форматирует их и пишет в stdout большими
+// кусками. Судья при этом не делает ни одного системного вызова на ход.
+//
+// Уровни (флаг --log):
+//   off     - только итог турнира
+//   rounds  - раунды, игроки без пары и сводка по раунду
+//   matches - плюс начало и победитель каждого матча
+//   moves   - плюс каждый ход и ничьи (по умолчанию, как раньше)
+//
+// Строки одного матча выводятся вместе и в порядке номеров матчей, даже если матчи
+// раунда играются параллельно и заканчиваются вперемешку. С --dataflow матчи нумеруются
+// сквозь всю сетку, и матч следующего раунда ждет в буфере, пока не напечатан весь
+// предыдущий раунд, так что лог совпадает с логом обычного режима.
+
+enum LogLevel { LOG_OFF, LOG_ROUNDS, LOG_MATCHES, LOG_MOVES };
+
+inline LogLevel logLevel = LOG_MOVES;
+
+// разбирает аргумент --log, возвращает false для неизвестного уровня
+inline bool setLogLevel(const char* name) {
+    const char* names[] = {"off", "rounds", "matches", "moves"};
+    for (int level = LOG_OFF; level <= LOG_MOVES; level++) {
+        if (strcmp(name, names[level]) == 0) {
+            logLevel = static_cast<LogLevel>(level);
+            return true;
+        }
+    }
+    return false;
+}
+
+class TourLog {
+public:
+    // запускает фоновый поток. Вызывается после fork игроков, чтобы потоки не копировались в детей
+    void start() {
+        slots = std::vector<Slot>(CAPACITY);
+        for (size_t i = 0; i < CAPACITY; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        head = 0;
+        tail.store(0, std::memory_order_relaxed);
+        stopping = false;
+
+        // всё, что напечатано до турнира через std::cout, должно выйти раньше лога
+        std::cout.flush();
+        writer = std::thread([this] { writerLoop(); });
+    }
+
+    // дожидается, пока все записи будут напечатаны, и останавливает поток
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        writer.join();
+    }
+
+    // firstMatch - сквозной номер первого матча раунда; по раундам матчи нумеруются заново с нуля.
+    // Игрок без пары пишется отдельной записью перед заголовком, а печатается после него
+    void roundStart(int round, int matchCount, int bye = -1, int firstMatch = 0) {
+        if (logLevel >= LOG_ROUNDS) {
+            if (bye >= 0) {
+                push({BYE, 0, bye, 0});
+            }
+            push({ROUND_START, firstMatch, round, matchCount});
+        }
+    }
+
+    // сводка нужна только на уровне rounds: на подробных уровнях она видна из самих матчей
+    void roundEnd(int matchCount, int draws) {
+        if (logLevel == LOG_ROUNDS) {
+            push({ROUND_END, 0, matchCount, draws});
+        }
+    }
+
+    void matchStart(int match, int player1, int player2) {
+        if (logLevel >= LOG_MATCHES) {
+            push({MATCH_START, match, player1, player2});
+        }
+    }
+
+    void attempt(int match, int choice1, int choice2) {
+        if (logLevel >= LOG_MOVES) {
+            push({ATTEMPT, match, choice1, choice2});
+        }
+    }
+
+    void matchDecided(int match, int winner) {
+        if (logLevel >= LOG_MATCHES) {
+            push({WINNER, match, winner, 0});
+        }
+    }
+
+private:
+    enum RecordType { ROUND_START, BYE, ROUND_END, MATCH_START, ATTEMPT, WINNER };
+
+    struct Record {
+        int type;
+        int match;
+        int a;
+        int b;
+    };
+
+    // ячейка ограниченной очереди Вьюкова: sequence говорит, чья сейчас очередь - писателя
+    // (sequence == позиция) или читателя (sequence == позиция + 1)
+    struct Slot {
+        std::atomic<size_t> sequence;
+        Record record;
+    };
+
+    // 64K записей по 24 байта. Раунд из тысяч параллельных матчей пишется без ожидания
+    static constexpr size_t CAPACITY = 1 << 16;
+    static constexpr auto POLL_INTERVAL = std::chrono::milliseconds(2);
+
+    // судей может быть несколько (шарды), поэтому место в кольце занимается через CAS
+    void push(const Record& record) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots[pos & (CAPACITY - 1)];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // кольцо заполнено: будим писателя и ждем, пока он освободит место
+                wake.notify_one();
+                std::this_thread::yield();
+                pos = tail.load(std::memory_order_relaxed);
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->record = record;
+        slot->sequence.store(pos + 1, std::memory_order_release);
+
+        // писатель сам просыпается раз в POLL_INTERVAL, будить его нужно только когда кольцо
+        // заполнилось наполовину - один системный вызов на 32K записей
+        if (((pos + 1) & (CAPACITY / 2 - 1)) == 0) {
+            wake.notify_one();
+        }
+    }
+
+    bool pending() const {
+        return slots[head & (CAPACITY - 1)].sequence.load(std::memory_order_acquire) == head + 1;
+    }
+
+    void writerLoop() {
+        for (;;) {
+            while (pending()) {
+                Slot& slot = slots[head & (CAPACITY - 1)];
+                format(slot.record);
+                slot.sequence.store(head + CAPACITY, std::memory_order_release);
+                head++;
+                if (out.size() >= FLUSH_BYTES) {
+                    flush();
+                }
+            }
+            flush();
+
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            if (stopping && !pending()) {
+                break;
+            }
+            wake.wait_for(lock, POLL_INTERVAL, [this] { return stopping || pending(); });
+        }
+    }
+
+    void format(const Record& record) {
+        switch (record.type) {
+        case ROUND_START:
+            out += "\nРаунд " + std::to_string(record.a) + "\n";
+            if (bye >= 0) {
+                out += "Студент " + std::to_string(bye + 1) + " проходит в следующий раунд\n";
+                bye = -1;
+            }
+            if (record.match == 0) {
+                matches.assign(record.b, MatchLog{});
+                nextMatch = 0;
+            } else if (matches.size() < static_cast<size_t>(record.match + record.b)) {
+                matches.resize(record.match + record.b);
+            }
+            opened = record.match + record.b;
+            drain();
+            break;
+        case BYE:
+            bye = record.a;
+            break;
+        case ROUND_END:
+            out += "Сыграно матчей: " + std::to_string(record.a) + ", переигровок: " + std::to_string(record.b) + "\n";
+            break;
+        case MATCH_START: {
+            MatchLog& match = matchLog(record.match);
+            match.player1 = record.a;
+            match.player2 = record.b;
+            match.text += "Матч между " + std::to_string(record.a + 1) + " и " + std::to_string(record.b + 1) + "\n";
+            break;
+        }
+        case ATTEMPT: {
+            MatchLog& match = matchLog(record.match);
+            match.text += "   Игрок " + std::to_string(match.player1 + 1) + " выбрал " + moveNames[record.a] + "\n";
+            match.text += "   Игрок " + std::to_string(match.player2 + 1) + " выбрал " + moveNames[record.b] + "\n";
+            if (record.a == record.b) {
+                match.text += "  Ничья, матч переигрывается... \n";
+            }
+            break;
+        }
+        case WINNER: {
+            MatchLog& match = matchLog(record.match);
+            match.text += "  Игрок " + std::to_string(record.a + 1) + " победил\n";
+            match.decided = true;
+            drain();
+            break;
+        }
+        }
+    }
+
+    // строки одного матча копятся здесь, пока не закончатся все матчи раунда с меньшими номерами
+    struct MatchLog {
+        int player1 = 0;
+        int player2 = 0;
+        bool decided = false;
+        std::string text;
+    };
+
+    // с --dataflow матч раунда может начаться раньше, чем напечатан заголовок его раунда
+    MatchLog& matchLog(int match) {
+        if (matches.size() <= static_cast<size_t>(match)) {
+            matches.resize(match + 1);
+        }
+        return matches[match];
+    }
+
+    // законченные матчи уходят в вывод по порядку номеров, как только готовы все предыдущие
+    // и напечатан заголовок их раунда
+    void drain() {
+        while (nextMatch < opened && matches[nextMatch].decided) {
+            out += matches[nextMatch].text;
+            std::string().swap(matches[nextMatch].text);
+            nextMatch++;
+        }
+    }
+
+    void flush() {
+        size_t written = 0;
+        while (written < out.size()) {
+            ssize_t bytes = write(STDOUT_FILENO, out.data() + written, out.size() - written);
+            if (bytes == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            written += bytes;
+        }
+        out.clear();
+    }
+
+    static constexpr size_t FLUSH_BYTES = 64 * 1024;
+    const char* moveNames[3] = {"камень", "ножницы", "бумага"};
+
+    std::vector<Slot> slots;
+    alignas(64) std::atomic<size_t> tail{0}; // следующая позиция для судей
+    alignas(64) size_t head = 0;             // следующая позиция для писателя
+
+    std::thread writer;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    std::vector<MatchLog> matches;
+    int nextMatch = 0;
+    int opened = 0;  // матчи с меньшими номерами уже под своим заголовком раунда
+    int bye = -1;    // игрок без пары раунда, чей заголовок еще не напечатан
+    std::string out;
+};
+
+// в куче и без деструктора: обработчик SIGINT вызывает exit() при работающем потоке писателя
+inline TourLog& tourLog = *new TourLog;
+
+#endif
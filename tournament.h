@@ -0,0 +1,625 @@
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <chrono>
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <condition_variable>
+
+#include "referee.h"
+#include "tourlog.h"
+#include "bench.h"
+#include "tourstats.h"
+#include "tourtrace.h"
+
+// Движок турнира, общий для всех вариантов: сетка, пары, игрок без пары, переигровка ничьих
+// и учет победителей. Варианты отличаются только транспортом - тем, как попросить ход
+// и как его получить. Транспорт передается параметром шаблона, поэтому вызовы на горячем
+// пути статические и встраиваются.
+//
+// Транспорт обязан предоставить:
+//   void requestMove(int player)  - попросить игрока сделать ход
+//   PlayerMove collectMove()      - дождаться хода любого игрока
+//   void shutdown()               - разбудить и дождаться дочерние процессы, освободить ресурсы
+//                                   (вызывает сам вариант, движок его не трогает)
+// Остальное есть в TransportBase и переопределяется при необходимости.
+
+// ход, который транспорт доставил судье. С --pipeline в move лежат несколько ходов по 2 бита
+struct PlayerMove {
+    int player;
+    int move;
+};
+
+// состояние матча на стороне главного процесса
+struct Match {
+    int player1;
+    int player2;
+    int choice1;
+    int choice2;
+    int moves_received;
+};
+
+// матч сетки в режиме --dataflow: куда уходит победитель и скольких игроков матч еще ждет
+struct BracketNode {
+    int round;
+    int parent;   // матч, в который проходит победитель; у финала -1
+    int side;     // 0 - победитель станет player1 родителя, 1 - player2
+    int waiting;  // сколько соседних матчей еще не закончились
+    int owner;    // судья, который ведет матч (см. splitBracket); без разделения 0
+};
+
+// раунд сетки: матчи раунда идут подряд с номера first
+struct BracketRound {
+    int first;
+    int count;
+    int bye;      // откуда игрок без пары: матч (>= 0), игрок ~bye (< 0) или никто (BRACKET_NO_BYE)
+};
+
+constexpr int BRACKET_NO_BYE = INT32_MIN;
+
+// работа для судьи в режиме перехвата: начать матч или переиграть его после ничьей.
+// Между попытками у матча нет запросов в полете, поэтому его может доиграть любой судья
+struct StealItem {
+    int match;
+    bool replay;
+};
+
+// очередь готовых матчей одного судьи: владелец берет с конца, остальные перехватывают с начала
+struct alignas(64) StealQueue {
+    std::mutex mutex;
+    std::deque<StealItem> items;
+};
+
+template <typename Derived>
+struct TransportBase {
+    // сколько ходов по 2 бита приходит в одном PlayerMove
+    int movesPerRequest() const { return 1; }
+
+    void onRoundStart(int round) {}
+    void onMatchStart(const Match& match) {}
+    void onMatchDecided(int winner, int loser) {}
+    void onFinish(int winner) {}
+
+    // играет все матчи раунда. Транспорт может сыграть раунд по-своему (шарды судьи,
+    // пакетный судья), пользуясь startMatch / reportResult движка
+    template <typename Engine>
+    void playRound(Engine& engine, std::vector<Match>& matches, int winnersOffset) {
+        engine.playMatches(static_cast<Derived&>(*this), matches, winnersOffset);
+    }
+
+    // играет всю сетку --dataflow. Транспорт с несколькими каналами может разделить ее
+    // между судьями через splitBracket / playOwned
+    template <typename Engine>
+    void playBracket(Engine& engine) {
+        engine.playOwned(static_cast<Derived&>(*this), 0);
+    }
+};
+
+template <typename Transport>
+class Tournament {
+public:
+    // dataflow - играть без барьера между раундами: матч начинается, как только известны оба игрока
+    Tournament(Transport& transport, int n, bool concurrent, bool dataflow = false)
+        : transport(transport), n(n), concurrent(concurrent || dataflow), dataflow(dataflow),
+          matchOf(n, -1), roundWinners(n), roundDraws(static_cast<int>(std::ceil(std::log2(n))) + 1) {
+        if (benchMode) {
+            requestedAt.resize(n);
+        }
+    }
+
+    // играет турнир до одного победителя и возвращает его номер (с нуля)
+    int run() {
+        tourLog.start();
+        auto start = std::chrono::steady_clock::now();
+        benchStats.runStart = start;
+
+        int winner = play();
+        tourLog.stop();
+        std::cout << "\nТурнир закончен, выиграл игрок под номером: " << winner + 1 << std::endl;
+
+        // для сравнения пропускной способности транспортов
+        benchStats.runEnd = std::chrono::steady_clock::now();
+        benchStats.matches = n - 1;
+        benchStats.moves = movesPlayed;
+        double seconds = std::chrono::duration<double>(benchStats.runEnd - start).count();
+        std::cout << "Ходов: " << movesPlayed << ", ходов в секунду: "
+                  << static_cast<long>(movesPlayed / seconds) << std::endl;
+        return winner;
+    }
+
+    // играет турнир без фонового лога, печати итога и замеров --bench: так несколько движков
+    // с отключенным логом могут играть разные турниры параллельно (tourserver.cpp)
+    int play() {
+        int winner = dataflow ? playBracket() : playRounds();
+        transport.onFinish(winner);
+        tourStats.finish(winner);
+        return winner;
+    }
+
+    long moves() const {
+        return movesPlayed;
+    }
+
+    // раунд за раундом: следующий раунд собирается из победителей, когда сыграны все матчи текущего
+    int playRounds() {
+        std::vector<int> activeStudents(n);
+        for (int i = 0; i < n; i++) {
+            activeStudents[i] = i;
+        }
+
+        int numRounds = static_cast<int>(std::ceil(std::log2(n)));
+        for (int round = 1; round <= numRounds && activeStudents.size() > 1; round++) {
+            currentRound = round;
+            int winnersCount = 0;
+            int bye = -1;
+            if (activeStudents.size() % 2 == 1) {
+                bye = activeStudents.back();
+                activeStudents.pop_back();
+                roundWinners[winnersCount++] = bye;
+            }
+            tourLog.roundStart(round, activeStudents.size() / 2, bye);
+            transport.onRoundStart(round);
+
+            // победители матчей записываются по номеру матча, чтобы сетка не зависела от порядка завершения
+            int winnersOffset = winnersCount;
+            int matchCount = activeStudents.size() / 2;
+            std::vector<Match> matches(matchCount);
+            tourStats.roundStart(round, matchCount);
+            for (int m = 0; m < matchCount; m++) {
+                matches[m] = {activeStudents[2 * m], activeStudents[2 * m + 1], 0, 0, 0};
+                matchOf[matches[m].player1] = m;
+                matchOf[matches[m].player2] = m;
+            }
+
+            tourTrace.event(TRACE_ROUND_BEGIN, round);
+            transport.playRound(*this, matches, winnersOffset);
+            tourTrace.event(TRACE_ROUND_END);
+            tourLog.roundEnd(matchCount, roundDraws[round]);
+
+            activeStudents.assign(roundWinners.begin(), roundWinners.begin() + winnersOffset + matchCount);
+        }
+        return activeStudents[0];
+    }
+
+    // сетка без барьеров: все n - 1 матчей строятся заранее, победитель сразу уходит в родительский
+    // матч, и тот начинается, как только закончены оба соседних матча. Пары те же, что и в playRounds,
+    // поэтому при том же сиде победитель и лог совпадают, а время турнира определяет самая длинная
+    // цепочка матчей, а не сумма самых долгих матчей каждого раунда. Раунды для лога, метрик
+    // и трассы закрываются по порядку, когда сыграны все их матчи
+    int playBracket() {
+        buildBracket();
+        roundsLeft.resize(rounds.size());
+        for (size_t r = 0; r < rounds.size(); r++) {
+            roundsLeft[r] = rounds[r].count;
+        }
+        openRound = 0;
+        beginRound(openRound);
+
+        transport.playBracket(*this);
+        return roundWinners[bracketMatches.size() - 1];
+    }
+
+    // делит сетку между shards судьями: игроки режутся на shards непрерывных отрезков, и судья
+    // отрезка получает все матчи, в которых встречаются только его игроки. Матчи, где сходятся
+    // игроки разных отрезков, достаются верхнему судье с номером shards. Такой матч зависит
+    // только от матчей судей отрезков, поэтому верхний судья может играть после них
+    void splitBracket(int shards) {
+        constexpr int UNSET = -1;
+        int total = bracketMatches.size();
+        std::vector<int> owner(total, UNSET);
+        auto merge = [shards](int& into, int from) {
+            into = into == UNSET || into == from ? from : shards;
+        };
+
+        for (int m = 0; m < total; m++) {
+            if (bracketMatches[m].player1 >= 0) {
+                merge(owner[m], static_cast<long>(bracketMatches[m].player1) * shards / n);
+            }
+            if (bracketMatches[m].player2 >= 0) {
+                merge(owner[m], static_cast<long>(bracketMatches[m].player2) * shards / n);
+            }
+        }
+        // матчи-источники всегда раньше по номеру, поэтому к матчу m владелец уже собран
+        ownedCount.assign(shards + 1, 0);
+        for (int m = 0; m < total; m++) {
+            bracket[m].owner = owner[m];
+            ownedCount[owner[m]]++;
+            if (bracket[m].parent >= 0) {
+                merge(owner[bracket[m].parent], owner[m]);
+            }
+        }
+    }
+
+    // судья owner играет свои матчи сетки через channel: начинает готовые и принимает ходы, пока
+    // не определятся все победители. Несколько судей работают параллельно из разных потоков
+    template <typename Channel>
+    void playOwned(Channel& channel, int owner) {
+        int total = ownedCount.empty() ? bracketMatches.size() : ownedCount[owner];
+        for (size_t m = 0; m < bracketMatches.size(); m++) {
+            if (bracket[m].owner == owner && bracket[m].waiting == 0) {
+                launch(channel, m);
+            }
+        }
+
+        std::vector<uint64_t> latencies;
+        for (int decided = 0; decided < total;) {
+            int m = receiveMove(channel, bracketMatches, 0, latencies);
+            if (m < 0) {
+                continue;
+            }
+            decided++;
+
+            int next = advanceBracket(m);
+            if (next >= 0 && bracket[next].owner == owner) {
+                launch(channel, next);
+            }
+        }
+
+        if (benchMode) {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            benchStats.latencies.insert(benchStats.latencies.end(), latencies.begin(), latencies.end());
+        }
+    }
+
+    // готовит сетку к игре referees судьями с перехватом работы: матчи первого раунда раздаются
+    // непрерывными кусками, у каждого судьи в полете не больше window матчей
+    void shareBracket(int referees, int window) {
+        stealQueues = std::vector<StealQueue>(referees);
+        stealWindow = std::max(1, window);
+        int count = rounds[0].count;
+        for (int m = 0; m < count; m++) {
+            stealQueues[static_cast<long>(m) * referees / count].items.push_back({m, false});
+        }
+        queued = count;
+    }
+
+    // судья referee играет сетку вместе с остальными. Готовые матчи и переигровки после ничьей
+    // кладутся в его очередь, а когда своя очередь пуста, он забирает самые старые матчи у других.
+    // Так длинная серия ничьих у одного судьи не оставляет остальных без работы
+    template <typename Channel>
+    void playShared(Channel& channel, int referee) {
+        StealQueue& own = stealQueues[referee];
+        std::vector<uint64_t> latencies;
+        int inFlight = 0;
+        while (true) {
+            StealItem item;
+            while (inFlight < stealWindow && takeWork(referee, item)) {
+                if (item.replay) {
+                    requestMove(channel, bracketMatches[item.match].player1);
+                    requestMove(channel, bracketMatches[item.match].player2);
+                } else {
+                    launch(channel, item.match);
+                }
+                inFlight++;
+            }
+            if (inFlight == 0) {
+                if (!waitForWork()) {
+                    break;
+                }
+                continue;
+            }
+
+            int m = receiveMove(channel, bracketMatches, 0, latencies, &own);
+            if (m == -1) {
+                continue;
+            }
+            inFlight--;
+            if (m < 0) {
+                continue; // ничья: переигровка уже в очереди
+            }
+
+            int next = advanceBracket(m);
+            if (next >= 0) {
+                pushWork(own, {next, false});
+            }
+            if (++decidedMatches == static_cast<int>(bracketMatches.size())) {
+                std::lock_guard<std::mutex> lock(stealMutex);
+                stealWake.notify_all();
+            }
+        }
+
+        if (benchMode) {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            benchStats.latencies.insert(benchStats.latencies.end(), latencies.begin(), latencies.end());
+        }
+    }
+
+    // сколько матчей судьи забрали из чужих очередей
+    long stolenMatches() const {
+        return stolen;
+    }
+
+    // играет матчи first, first + step, ... раунда, принимая ходы через channel по мере их поступления.
+    // Несколько каналов могут играть свои матчи одного раунда параллельно из разных потоков
+    template <typename Channel>
+    void playMatches(Channel& channel, std::vector<Match>& matches, int winnersOffset, int first = 0, int step = 1) {
+        int total = matches.size();
+        int matchCount = first < total ? (total - first + step - 1) / step : 0;
+
+        // в конкурентном режиме запускаются сразу все матчи, иначе по одному
+        int window = concurrent ? matchCount : 1;
+        int started = 0;
+        int decided = 0;
+        std::vector<uint64_t> latencies;
+        while (started < window && started < matchCount) {
+            startMatch(channel, matches[first + step * started++]);
+        }
+
+        while (decided < matchCount) {
+            if (receiveMove(channel, matches, winnersOffset, latencies) < 0) {
+                continue;
+            }
+
+            decided++;
+            if (started < matchCount) {
+                startMatch(channel, matches[first + step * started++]);
+            }
+        }
+
+        if (benchMode) {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            benchStats.latencies.insert(benchStats.latencies.end(), latencies.begin(), latencies.end());
+        }
+    }
+
+    template <typename Channel>
+    void startMatch(Channel& channel, const Match& match) {
+        tourLog.matchStart(matchOf[match.player1], match.player1, match.player2);
+        channel.onMatchStart(match);
+        requestMove(channel, match.player1);
+        requestMove(channel, match.player2);
+    }
+
+    // с --bench запоминает время запроса, чтобы playMatches посчитал задержку хода
+    template <typename Channel>
+    void requestMove(Channel& channel, int player) {
+        if (benchMode) {
+            requestedAt[player] = benchNow();
+        }
+        tourTrace.event(TRACE_REQUEST, player);
+        channel.requestMove(player);
+    }
+
+    // пишет в лог исход одной попытки матча и записывает победителя. Возвращает false при ничьей
+    template <typename Channel>
+    bool reportResult(Channel& channel, const Match& match, int matchIdx, int winnersOffset,
+                      int choice1, int choice2, int result) {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        movesPlayed += 2;
+
+        int round = dataflow ? bracket[matchIdx].round : currentRound;
+        tourLog.attempt(matchIdx, choice1, choice2);
+        tourStats.attempt(result == 0);
+        if (result == 0) {
+            tourTrace.event(TRACE_DRAW, match.player1);
+            roundDraws[round]++;
+            return false;
+        }
+
+        int winner = result == 1 ? match.player1 : match.player2;
+        int loser = result == 1 ? match.player2 : match.player1;
+        tourLog.matchDecided(matchIdx, winner);
+        tourStats.matchDone(round);
+        tourTrace.event(TRACE_DECIDE, winner);
+
+        roundWinners[winnersOffset + matchIdx] = winner;
+        channel.onMatchDecided(winner, loser);
+        return true;
+    }
+
+private:
+    // ждет ход любого игрока и засчитывает его. Когда пришли оба хода матча, судит; при ничьей
+    // просит новые ходы, а если передана очередь replays - кладет переигровку в нее.
+    // Возвращает номер матча, если в нем определился победитель, -2 после ничьей с replays, иначе -1
+    template <typename Channel>
+    int receiveMove(Channel& channel, std::vector<Match>& matches, int winnersOffset, std::vector<uint64_t>& latencies,
+                    StealQueue* replays = nullptr) {
+        int64_t waitStart = tourStats.clock();
+        tourTrace.event(TRACE_REFEREE_WAIT);
+        PlayerMove move = channel.collectMove();
+        tourTrace.event(TRACE_REFEREE_WAKE, move.player);
+        tourStats.refereeWaited(waitStart);
+        if (benchMode) {
+            latencies.push_back(benchNow() - requestedAt[move.player]);
+        }
+
+        // ходы приходят в произвольном порядке, поэтому матч определяется по номеру игрока
+        int matchIdx = matchOf[move.player];
+        Match& match = matches[matchIdx];
+        if (move.player == match.player1) {
+            match.choice1 = move.move;
+        } else {
+            match.choice2 = move.move;
+        }
+
+        if (++match.moves_received < 2) {
+            return -1;
+        }
+        match.moves_received = 0;
+
+        // с --pipeline ничьи переигрываются по уже присланным ходам без новых запросов
+        bool done = false;
+        for (int attempt = 0; attempt < channel.movesPerRequest() && !done; attempt++) {
+            int choice1 = (match.choice1 >> (2 * attempt)) & 3;
+            int choice2 = (match.choice2 >> (2 * attempt)) & 3;
+            done = reportResult(channel, match, matchIdx, winnersOffset, choice1, choice2, referee(choice1, choice2));
+        }
+
+        if (!done && replays) {
+            pushWork(*replays, {matchIdx, true});
+            return -2;
+        }
+        if (!done) {
+            requestMove(channel, match.player1);
+            requestMove(channel, match.player2);
+            return -1;
+        }
+        return matchIdx;
+    }
+
+    void pushWork(StealQueue& queue, StealItem item) {
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.items.push_back(item);
+        }
+        queued++;
+        if (idleReferees > 0) {
+            std::lock_guard<std::mutex> lock(stealMutex);
+            stealWake.notify_one();
+        }
+    }
+
+    // своя работа берется с конца очереди (свежие родительские матчи и переигровки),
+    // чужая - с начала, где лежат самые старые матчи
+    bool takeWork(int referee, StealItem& item) {
+        int referees = stealQueues.size();
+        for (int i = 0; i < referees; i++) {
+            StealQueue& queue = stealQueues[(referee + i) % referees];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.items.empty()) {
+                continue;
+            }
+            if (i == 0) {
+                item = queue.items.back();
+                queue.items.pop_back();
+            } else {
+                item = queue.items.front();
+                queue.items.pop_front();
+                stolen++;
+            }
+            queued--;
+            return true;
+        }
+        return false;
+    }
+
+    // раскладывает сетку playRounds в дерево: на каждом раунде игрок без пары - последний
+    // в списке, и в следующем раунде он идет первым, за ним победители матчей по порядку
+    void buildBracket() {
+        std::vector<int> sources(n);   // матч, из которого придет игрок, или ~номер самого игрока
+        for (int i = 0; i < n; i++) {
+            sources[i] = ~i;
+        }
+
+        for (int round = 1; sources.size() > 1; round++) {
+            std::vector<int> next;
+            int bye = BRACKET_NO_BYE;
+            if (sources.size() % 2 == 1) {
+                bye = sources.back();
+                sources.pop_back();
+                next.push_back(bye);
+            }
+            rounds.push_back({static_cast<int>(bracketMatches.size()), static_cast<int>(sources.size() / 2), bye});
+
+            for (size_t k = 0; k < sources.size(); k += 2) {
+                int m = bracketMatches.size();
+                bracketMatches.push_back({-1, -1, 0, 0, 0});
+                bracket.push_back({round, -1, 0, 0, 0});
+                for (int side = 0; side < 2; side++) {
+                    int source = sources[k + side];
+                    if (source < 0) {
+                        (side == 0 ? bracketMatches[m].player1 : bracketMatches[m].player2) = ~source;
+                    } else {
+                        bracket[source].parent = m;
+                        bracket[source].side = side;
+                        bracket[m].waiting++;
+                    }
+                }
+                next.push_back(m);
+            }
+            sources.swap(next);
+        }
+    }
+
+    // ждет, пока у кого-нибудь появится работа или закончится сетка. Возвращает false в конце
+    bool waitForWork() {
+        std::unique_lock<std::mutex> lock(stealMutex);
+        idleReferees++;
+        stealWake.wait(lock, [this] { return queued > 0 || decidedMatches == static_cast<int>(bracketMatches.size()); });
+        idleReferees--;
+        return queued > 0;
+    }
+
+    template <typename Channel>
+    void launch(Channel& channel, int m) {
+        matchOf[bracketMatches[m].player1] = m;
+        matchOf[bracketMatches[m].player2] = m;
+        startMatch(channel, bracketMatches[m]);
+    }
+
+    // передает победителя матча m в родительский матч и закрывает законченные раунды.
+    // Возвращает родительский матч, если в нем теперь известны оба игрока, иначе -1
+    int advanceBracket(int m) {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        int ready = -1;
+        const BracketNode& node = bracket[m];
+        if (node.parent >= 0) {
+            Match& parent = bracketMatches[node.parent];
+            (node.side == 0 ? parent.player1 : parent.player2) = roundWinners[m];
+            if (--bracket[node.parent].waiting == 0) {
+                ready = node.parent;
+            }
+        }
+
+        if (--roundsLeft[node.round - 1] == 0) {
+            while (openRound < rounds.size() && roundsLeft[openRound] == 0) {
+                endRound(openRound++);
+                if (openRound < rounds.size()) {
+                    beginRound(openRound);
+                }
+            }
+        }
+        return ready;
+    }
+
+    // раунд открывается, когда закрыт предыдущий, поэтому игрок без пары к этому моменту известен
+    void beginRound(size_t r) {
+        const BracketRound& info = rounds[r];
+        int round = r + 1;
+        int bye = info.bye == BRACKET_NO_BYE ? -1 : info.bye < 0 ? ~info.bye : roundWinners[info.bye];
+        tourLog.roundStart(round, info.count, bye, info.first);
+        transport.onRoundStart(round);
+        tourStats.roundStart(round, info.count);
+        tourTrace.event(TRACE_ROUND_BEGIN, round);
+    }
+
+    void endRound(size_t r) {
+        tourTrace.event(TRACE_ROUND_END);
+        tourLog.roundEnd(rounds[r].count, roundDraws[r + 1]);
+    }
+
+    Transport& transport;
+    int n;
+    bool concurrent;
+    bool dataflow;
+    std::vector<int> matchOf;
+    std::vector<int> roundWinners;    // по раундам - победители раунда, в сетке - победитель каждого матча
+    std::vector<int64_t> requestedAt; // только с --bench
+    long movesPlayed = 0;
+    int currentRound = 0;
+    std::vector<int> roundDraws;
+    std::vector<Match> bracketMatches; // только с --dataflow: все матчи сетки
+    std::vector<BracketNode> bracket;
+    std::vector<BracketRound> rounds;
+    std::vector<int> roundsLeft;      // сколько матчей раунда еще не сыграно
+    size_t openRound = 0;             // первый раунд, в котором сыграны не все матчи
+    std::vector<int> ownedCount;      // сколько матчей у каждого судьи после splitBracket
+    std::vector<StealQueue> stealQueues; // только с перехватом работы (shareBracket)
+    int stealWindow = 0;
+    std::atomic<int> queued{0};       // матчей во всех очередях
+    std::atomic<int> idleReferees{0};
+    std::atomic<int> decidedMatches{0};
+    std::atomic<long> stolen{0};
+    std::mutex stealMutex;            // только для stealWake
+    std::condition_variable stealWake;
+    std::mutex statsMutex; // шарды судьи считают ходы, записывают победителей и двигают сетку из разных потоков
+};
+
+#endif
@@ -0,0 +1,483 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <cerrno>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "tournament.h"
+#include "rng.h"
+#include "futex.h"
+
+// Сервер турниров: один раз создает разделяемую память и пул воркеров, а потом играет турниры
+// по запросам через Unix-сокет, не пересоздавая ни процессов, ни объектов IPC. Транспорт тот же,
+// что в main_futex.cpp (futex-счетчики и очереди в общей памяти), но рассчитан на несколько
+// турниров сразу: у каждого турнира свой "стол" - очередь готовых ходов со своим счетчиком,
+// и свой непрерывный отрезок мест для игроков. Воркер обслуживает места, а не турниры: поток
+// случайных чисел и стол игрока сервер перед турниром записывает прямо в его ячейку.
+//
+// Запрос - одна строка с флагами, как у вариантов: "--players N --seed S [--concurrent] [--dataflow]".
+// Ответ - одна строка "winner=... moves=... ..." или "error: ...". Клиент - tourclient.cpp.
+
+#define SHM_NAME "/tourserver_shm"
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "атомики в разделяемой памяти должны быть lock-free");
+static_assert(std::atomic<int>::is_always_lock_free, "атомики в разделяемой памяти должны быть lock-free");
+static_assert(std::atomic<bool>::is_always_lock_free, "атомики в разделяемой памяти должны быть lock-free");
+
+// место игрока. rng и table сервер переписывает перед каждым турниром, занявшим это место
+struct ServerSlot {
+    PlayerRng rng;
+    int move;
+    int table;
+};
+
+// очередь запросов воркера. Запросы кладут судьи разных турниров, поэтому позиция
+// берется через fetch_add на tail, а word растет на каждый положенный запрос
+struct alignas(64) WorkerQueue {
+    FutexWord word;
+    std::atomic<uint32_t> tail;
+};
+
+// стол турнира: очередь готовых ходов и счетчик, на котором спит судья этого турнира
+struct alignas(64) TableState {
+    FutexWord moves_posted;
+    std::atomic<uint32_t> ready_tail;
+};
+
+// заголовок разделяемой памяти, массивы лежат сразу за ним
+struct ServerState {
+    std::atomic<bool> is_finished; // выставляет сервер при остановке, читают воркеры
+    int capacity;               // мест для игроков
+    int workers;
+    int tables;
+    uint32_t request_mask;      // длина очереди воркера - степень двойки, маска для позиции
+    uint32_t ready_mask;        // то же для очереди стола
+    size_t slots_offset;
+    size_t queues_offset;
+    size_t requests_offset;
+    size_t tables_offset;
+    size_t ready_offset;
+
+    template <typename T>
+    T* array(size_t offset) {
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(this) + offset);
+    }
+
+    ServerSlot* slots() { return array<ServerSlot>(slots_offset); }
+    WorkerQueue* queues() { return array<WorkerQueue>(queues_offset); }
+    std::atomic<int>* requests(int worker) { return array<std::atomic<int>>(requests_offset) + worker * (request_mask + 1); }
+    TableState* table_states() { return array<TableState>(tables_offset); }
+    std::atomic<int>* ready(int table) { return array<std::atomic<int>>(ready_offset) + table * (ready_mask + 1); }
+};
+
+std::vector<pid_t> workerPids;
+int shm_fd;
+size_t shmSize;
+ServerState* serverState;
+const char* socketPath = "/tmp/tourserver.sock";
+int listenFd = -1;
+int capacity = 65536;
+int workers = 0;
+int tables = 4;
+
+// свободные места и столы; запрос ждет, пока их хватит
+std::mutex arenaMutex;
+std::condition_variable arenaFreed;
+std::vector<std::pair<int, int>> busy;  // занятые отрезки мест [начало, конец), по возрастанию
+std::vector<int> freeTables;
+std::mutex outputMutex;
+std::atomic<long> served{0};
+
+// забирает номер из ячейки очереди, дождавшись, пока писатель ее заполнит; -1 - ячейка пуста
+// и выставлен stop. Счетчик читается до проверки ячейки, иначе можно проспать публикацию
+int takeCell(std::atomic<int>& cell, FutexWord& word, const std::atomic<bool>& stop) {
+    while (true) {
+        uint32_t seen = word.value.load();
+        int value = cell.load(std::memory_order_acquire);
+        if (value != -1) {
+            cell.store(-1, std::memory_order_relaxed);
+            return value;
+        }
+        if (stop.load(std::memory_order_acquire)) {
+            return -1;
+        }
+        futexWait(word, seen);
+    }
+}
+
+uint32_t roundUpPow2(uint32_t x) {
+    uint32_t p = 1;
+    while (p < x) {
+        p <<= 1;
+    }
+    return p;
+}
+
+// выделяет место под массив в сегменте и возвращает его смещение
+size_t placeArray(size_t& size, size_t bytes, size_t align) {
+    size = (size + align - 1) / align * align;
+    size_t offset = size;
+    size += bytes;
+    return offset;
+}
+
+// считает смещения массивов, возвращает полный размер сегмента. У игрока в полете не больше
+// одного запроса, поэтому очереди воркера хватает числа его мест, а очереди стола - всех мест
+size_t layoutState(ServerState* layout) {
+    size_t size = sizeof(ServerState);
+    layout->capacity = capacity;
+    layout->workers = workers;
+    layout->tables = tables;
+    layout->request_mask = roundUpPow2((capacity + workers - 1) / workers) - 1;
+    layout->ready_mask = roundUpPow2(capacity) - 1;
+    layout->slots_offset = placeArray(size, capacity * sizeof(ServerSlot), alignof(ServerSlot));
+    layout->queues_offset = placeArray(size, workers * sizeof(WorkerQueue), alignof(WorkerQueue));
+    layout->requests_offset = placeArray(size, workers * (layout->request_mask + 1) * sizeof(std::atomic<int>), 64);
+    layout->tables_offset = placeArray(size, tables * sizeof(TableState), alignof(TableState));
+    layout->ready_offset = placeArray(size, tables * (layout->ready_mask + 1) * sizeof(std::atomic<int>), 64);
+    return size;
+}
+
+// воркер обслуживает места worker, worker + workers, ... всех турниров сразу
+void workerProcess(int worker) {
+    WorkerQueue& queue = serverState->queues()[worker];
+    std::atomic<int>* requests = serverState->requests(worker);
+    uint32_t head = 0;
+
+    while (true) {
+        int player = takeCell(requests[head & serverState->request_mask], queue.word, serverState->is_finished);
+        if (player == -1) {
+            break;
+        }
+        head++;
+
+        ServerSlot& slot = serverState->slots()[player];
+        slot.move = nextMove(slot.rng);
+
+        TableState& table = serverState->table_states()[slot.table];
+        uint32_t pos = table.ready_tail.fetch_add(1) & serverState->ready_mask;
+        serverState->ready(slot.table)[pos].store(player, std::memory_order_release);
+        futexBump(table.moves_posted);
+    }
+
+    exit(0);
+}
+
+// будит воркеров, дожидается их, удаляет разделяемую память и сокет. Сегмент не отображается
+// обратно: судьи незаконченных турниров еще читают его, а процесс сразу после этого завершается
+void shutdownServer() {
+    serverState->is_finished.store(true, std::memory_order_release);
+    for (int i = 0; i < workers; i++) {
+        futexBump(serverState->queues()[i].word);
+    }
+    for (pid_t pid : workerPids) {
+        waitpid(pid, nullptr, 0);
+    }
+
+    close(shm_fd);
+    shm_unlink(SHM_NAME);
+    close(listenFd);
+    unlink(socketPath);
+}
+
+// потоки соединений запускаются с заблокированным SIGINT, поэтому обработчик выполняется
+// в главном потоке. Незаконченные турниры бросаются: воркеры все равно завершаются
+void handle_sigint(int sig) {
+    std::cout << "Получен SIGINT, останавливаю сервер и очищаю ресурсы... Сыграно турниров: "
+              << served.load() << std::endl;
+    shutdownServer();
+    exit(0);
+}
+
+// транспорт одного турнира: его игроки - места base .. base + n - 1, ходы приходят на стол table
+struct ServerTransport : TransportBase<ServerTransport> {
+    int table;
+    int base;
+    uint32_t readyHead = 0;
+
+    void requestMove(int player) {
+        int place = base + player;
+        int worker = place % workers;
+        WorkerQueue& queue = serverState->queues()[worker];
+        uint32_t pos = queue.tail.fetch_add(1) & serverState->request_mask;
+        serverState->requests(worker)[pos].store(place, std::memory_order_release);
+        futexBump(queue.word);
+    }
+
+    PlayerMove collectMove() {
+        TableState& state = serverState->table_states()[table];
+        std::atomic<int>& cell = serverState->ready(table)[readyHead++ & serverState->ready_mask];
+        // судья ждет хода до конца: при остановке сервера процесс завершается вместе с ним
+        static const std::atomic<bool> never{false};
+        int place = takeCell(cell, state.moves_posted, never);
+        return {place - base, serverState->slots()[place].move};
+    }
+};
+
+// занимает стол и отрезок из n мест (первый подходящий), при нехватке ждет окончания других турниров
+void acquire(int n, int& table, int& base) {
+    std::unique_lock<std::mutex> lock(arenaMutex);
+    while (true) {
+        int start = 0;
+        size_t at = 0;
+        for (; at < busy.size() && busy[at].first - start < n; at++) {
+            start = busy[at].second;
+        }
+        bool fits = at < busy.size() || capacity - start >= n;
+        if (!freeTables.empty() && fits) {
+            table = freeTables.back();
+            freeTables.pop_back();
+            base = start;
+            busy.insert(busy.begin() + at, {start, start + n});
+            return;
+        }
+        arenaFreed.wait(lock);
+    }
+}
+
+void release(int table, int base) {
+    {
+        std::lock_guard<std::mutex> lock(arenaMutex);
+        freeTables.push_back(table);
+        busy.erase(std::find_if(busy.begin(), busy.end(), [&](const std::pair<int, int>& range) {
+            return range.first == base;
+        }));
+    }
+    arenaFreed.notify_all();
+}
+
+// разбирает строку запроса, играет турнир и возвращает строку ответа
+std::string serve(const std::string& line) {
+    std::vector<std::string> args;
+    std::istringstream tokens(line);
+    for (std::string token; tokens >> token;) {
+        args.push_back(token);
+    }
+
+    int n = 0;
+    uint64_t seed = 0;
+    bool seeded = false;
+    bool concurrent = false;
+    bool dataflow = false;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "--concurrent") {
+            concurrent = true;
+        } else if (args[i] == "--dataflow") {
+            dataflow = true;
+        } else if (args[i] == "--players" && i + 1 < args.size()) {
+            n = atoi(args[++i].c_str());
+        } else if (args[i] == "--seed" && i + 1 < args.size()) {
+            seed = strtoull(args[++i].c_str(), nullptr, 10);
+            seeded = true;
+        } else {
+            return "error: неизвестный аргумент " + args[i];
+        }
+    }
+
+    if (!seeded) {
+        seed = randomSeed();
+    }
+    if (n == 0) {
+        n = playersFromSeed(seed);
+    }
+    if (n < 2 || n > capacity) {
+        return "error: количество игроков должно быть от 2 до " + std::to_string(capacity);
+    }
+
+    auto requested = std::chrono::steady_clock::now();
+    ServerTransport transport;
+    acquire(n, transport.table, transport.base);
+
+    // сброс на месте: поток случайных чисел и стол каждого игрока, хвост очереди стола.
+    // Очередь стола после прошлого турнира пуста - судья забрал все ходы, которые просил
+    ServerSlot* slots = serverState->slots() + transport.base;
+    for (int i = 0; i < n; i++) {
+        slots[i].rng = playerRng(seed, i);
+        slots[i].table = transport.table;
+    }
+    serverState->table_states()[transport.table].ready_tail.store(0, std::memory_order_relaxed);
+
+    auto start = std::chrono::steady_clock::now();
+    Tournament<ServerTransport> tournament(transport, n, concurrent, dataflow);
+    int winner = tournament.play();
+    auto end = std::chrono::steady_clock::now();
+
+    release(transport.table, transport.base);
+    served++;
+
+    auto us = [](auto duration) { return std::chrono::duration_cast<std::chrono::microseconds>(duration).count(); };
+    std::ostringstream reply;
+    reply << "winner=" << winner + 1 << " moves=" << tournament.moves() << " players=" << n << " seed=" << seed
+          << " table=" << transport.table << " base=" << transport.base << " wait_us=" << us(start - requested)
+          << " run_us=" << us(end - start);
+    return reply.str();
+}
+
+// соединение может прислать несколько запросов подряд, по одному на строку
+void connectionThread(int fd) {
+    std::string buffer;
+    char chunk[4096];
+    while (true) {
+        size_t newline;
+        while ((newline = buffer.find('\n')) == std::string::npos) {
+            ssize_t got = read(fd, chunk, sizeof(chunk));
+            if (got <= 0) {
+                close(fd);
+                return;
+            }
+            buffer.append(chunk, got);
+        }
+
+        std::string reply = serve(buffer.substr(0, newline)) + "\n";
+        buffer.erase(0, newline + 1);
+        {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout << reply << std::flush;
+        }
+        // клиент мог уже закрыть соединение, SIGPIPE серверу не нужен
+        if (send(fd, reply.data(), reply.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(reply.size())) {
+            close(fd);
+            return;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (strcmp(argv[i], "--capacity") == 0 && i + 1 < argc) {
+            capacity = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--tables") == 0 && i + 1 < argc) {
+            tables = atoi(argv[++i]);
+        }
+    }
+
+    if (capacity < 2 || tables < 1) {
+        std::cerr << "Мест должно быть не меньше 2, столов - не меньше 1" << std::endl;
+        return 1;
+    }
+    // по умолчанию по одному воркеру на ядро
+    if (workers <= 0) {
+        workers = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    workers = std::max(1, std::min(workers, capacity));
+    // движки нескольких турниров работают параллельно, общий лог им не нужен
+    logLevel = LOG_OFF;
+
+    shm_fd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0666);
+    if (shm_fd == -1) {
+        perror("shm_open");
+        return 1;
+    }
+
+    ServerState layout{};
+    shmSize = layoutState(&layout);
+
+    if (ftruncate(shm_fd, shmSize) == -1) {
+        perror("ftruncate");
+        return 1;
+    }
+
+    serverState = (ServerState*) mmap(NULL, shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    if (serverState == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    // нулевые байты - корректное начальное значение для lock-free атомиков
+    memset(static_cast<void*>(serverState), 0, shmSize);
+    layoutState(serverState);
+    for (int w = 0; w < workers; w++) {
+        std::atomic<int>* requests = serverState->requests(w);
+        for (uint32_t i = 0; i <= serverState->request_mask; i++) {
+            requests[i].store(-1);
+        }
+    }
+    for (int t = 0; t < tables; t++) {
+        std::atomic<int>* ready = serverState->ready(t);
+        for (uint32_t i = 0; i <= serverState->ready_mask; i++) {
+            ready[i].store(-1);
+        }
+        freeTables.push_back(tables - 1 - t);
+    }
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd == -1) {
+        perror("socket");
+        return 1;
+    }
+    struct sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (strlen(socketPath) >= sizeof(addr.sun_path)) {
+        std::cerr << "Слишком длинный путь сокета: " << socketPath << std::endl;
+        return 1;
+    }
+    strcpy(addr.sun_path, socketPath);
+    unlink(socketPath);
+    if (bind(listenFd, (struct sockaddr*) &addr, sizeof(addr)) == -1 || listen(listenFd, 64) == -1) {
+        perror("bind");
+        return 1;
+    }
+
+    for (int i = 0; i < workers; i++) {
+        pid_t pid = fork();
+        if (pid == -1) {
+            perror("fork");
+            return 1;
+        }
+
+        if (pid == 0) {
+            workerProcess(i);
+        }
+
+        workerPids.push_back(pid);
+    }
+
+    struct sigaction sa{};
+    sa.sa_handler = handle_sigint;
+    sa.sa_flags = 0;
+    sigaction(SIGINT, &sa, nullptr);
+
+    std::cout << "Сервер турниров слушает " << socketPath << ": мест для игроков " << capacity
+              << ", воркеров " << workers << ", столов " << tables << std::endl;
+
+    while (true) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("accept");
+            shutdownServer();
+            return 1;
+        }
+
+        // маска сигналов наследуется потоком: SIGINT достается только главному потоку
+        sigset_t sigint, old;
+        sigemptyset(&sigint);
+        sigaddset(&sigint, SIGINT);
+        pthread_sigmask(SIG_BLOCK, &sigint, &old);
+        std::thread(connectionThread, fd).detach();
+        pthread_sigmask(SIG_SETMASK, &old, nullptr);
+    }
+}
@@ -0,0 +1,212 @@
+#ifndef TOURSTATS_H
+#define TOURSTATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// Живые метрики турнира для tourtop, общие для всех вариантов. С флагом --stats главный процесс
+// до fork создает сегмент /tourstats_<pid>, игроки наследуют его отображение. Каждый счетчик
+// пишет только один процесс: судья - свои, игрок (или воркер, сделавший ход за игрока) - свою
+// ячейку, поэтому хватает relaxed-записей без блокировок, а ячейки разных писателей лежат
+// в разных кэш-линиях. Исключение - судья с --shards: его счетчики прибавляются через fetch_add.
+// tourtop отображает сегмент только на чтение и ничего в нем не меняет.
+
+#define STATS_MAGIC 0x54535431 // "TST1"
+#define STATS_MAX_ROUNDS 64
+#define STATS_BUCKETS 24       // корзина b - ожидание короче 2^(b + 10) нс, последняя - все длиннее
+
+// ячейка игрока. Ожидание - время, которое игрок (или его воркер) провел в блокирующем вызове
+// (sem_wait, mq_receive, msgrcv, futex) перед тем как сделать ход
+struct alignas(64) PlayerStats {
+    std::atomic<uint64_t> moves;
+    std::atomic<uint64_t> wait_ns;
+    std::atomic<uint32_t> wait_hist[STATS_BUCKETS];
+};
+
+struct StatsSegment {
+    uint32_t magic;
+    int32_t players;
+    int64_t start_ns;          // CLOCK_MONOTONIC, общий для всех процессов
+    char variant[32];
+
+    // счетчики судьи. Обычно у них один писатель, а с шардами судья пишет из нескольких потоков
+    // и счетчики прибавляются через fetch_add (см. TourStats::setRefereeThreads)
+    alignas(64) std::atomic<int32_t> round;
+    std::atomic<int32_t> finished;
+    std::atomic<int32_t> winner;
+    std::atomic<uint64_t> moves;
+    std::atomic<uint64_t> draws;
+    std::atomic<uint64_t> referee_wait_ns;  // время судьи в ожидании хода (sem_wait, mq_receive, msgrcv, futex)
+    std::atomic<uint64_t> referee_waits;
+    std::atomic<int32_t> round_matches[STATS_MAX_ROUNDS];
+    std::atomic<int32_t> round_done[STATS_MAX_ROUNDS];
+
+    // ячейки игроков идут сразу за заголовком, его размер кратен кэш-линии
+    PlayerStats* player_stats() { return reinterpret_cast<PlayerStats*>(this + 1); }
+    const PlayerStats* player_stats() const { return reinterpret_cast<const PlayerStats*>(this + 1); }
+};
+
+inline size_t statsSegmentSize(int players) {
+    return sizeof(StatsSegment) + players * sizeof(PlayerStats);
+}
+
+inline std::string statsSegmentName(long pid) {
+    return "/tourstats_" + std::to_string(pid);
+}
+
+inline int statsBucket(uint64_t ns) {
+    int bits = ns < 1024 ? 0 : 64 - __builtin_clzll(ns) - 10;
+    return bits < STATS_BUCKETS ? bits : STATS_BUCKETS - 1;
+}
+
+inline int64_t statsNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class TourStats {
+public:
+    // создает сегмент; вызывается до fork, чтобы игроки унаследовали отображение
+    bool create(int players, const char* variant) {
+        owner = getpid();
+        name = statsSegmentName(owner);
+        size = statsSegmentSize(players);
+
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd == -1) {
+            perror("shm_open (stats)");
+            return false;
+        }
+        if (ftruncate(fd, size) == -1) {
+            perror("ftruncate (stats)");
+            close(fd);
+            shm_unlink(name.c_str());
+            return false;
+        }
+        void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mem == MAP_FAILED) {
+            perror("mmap (stats)");
+            shm_unlink(name.c_str());
+            return false;
+        }
+
+        // ftruncate заполняет сегмент нулями, остается заголовок
+        segment = static_cast<StatsSegment*>(mem);
+        segment->players = players;
+        segment->start_ns = statsNow();
+        strncpy(segment->variant, variant, sizeof(segment->variant) - 1);
+        segment->winner.store(-1);
+        segment->magic = STATS_MAGIC;
+
+        // обработчики SIGINT и ошибки завершают программу через exit(), так сегмент удаляется
+        // на любом пути. Дочерние процессы тоже зовут exit(), поэтому удаляет только создатель
+        static TourStats* self;
+        self = this;
+        atexit([] { self->destroy(); });
+        return true;
+    }
+
+    bool enabled() const {
+        return segment != nullptr;
+    }
+
+    // отметка времени перед блокирующим вызовом; без --stats часы не читаются
+    int64_t clock() const {
+        return segment ? statsNow() : 0;
+    }
+
+    void playerMoved(int player, int64_t waitStart) {
+        if (!segment) {
+            return;
+        }
+        uint64_t waited = statsNow() - waitStart;
+        PlayerStats& stats = segment->player_stats()[player];
+        bump(stats.moves, 1);
+        bump(stats.wait_ns, waited);
+        bump(stats.wait_hist[statsBucket(waited)], 1);
+    }
+
+    // с --shards счетчики судьи пишут несколько потоков; вызывается до начала турнира
+    void setRefereeThreads(int threads) {
+        sharedReferee = threads > 1;
+    }
+
+    void refereeWaited(int64_t waitStart) {
+        if (segment) {
+            refereeAdd(segment->referee_wait_ns, statsNow() - waitStart);
+            refereeAdd(segment->referee_waits, 1);
+        }
+    }
+
+    void roundStart(int round, int matches) {
+        if (segment && round < STATS_MAX_ROUNDS) {
+            segment->round_matches[round].store(matches, std::memory_order_relaxed);
+            segment->round.store(round, std::memory_order_release);
+        }
+    }
+
+    void attempt(bool draw) {
+        if (segment) {
+            refereeAdd(segment->moves, 2);
+            refereeAdd(segment->draws, draw);
+        }
+    }
+
+    // раунд передается явно: с --dataflow матчи следующих раундов идут до конца текущего
+    void matchDone(int round) {
+        if (segment && round < STATS_MAX_ROUNDS) {
+            refereeAdd(segment->round_done[round], 1);
+        }
+    }
+
+    void finish(int winner) {
+        if (segment) {
+            segment->winner.store(winner, std::memory_order_relaxed);
+            segment->finished.store(1, std::memory_order_release);
+        }
+    }
+
+    void destroy() {
+        if (segment && getpid() == owner) {
+            munmap(segment, size);
+            shm_unlink(name.c_str());
+            segment = nullptr;
+        }
+    }
+
+private:
+    // у счетчика игрока один писатель, поэтому хватает чтения и записи без атомарного сложения
+    template <typename T>
+    static void bump(std::atomic<T>& counter, uint64_t delta) {
+        counter.store(counter.load(std::memory_order_relaxed) + static_cast<T>(delta), std::memory_order_relaxed);
+    }
+
+    // счетчик судьи: атомарное сложение нужно только когда пишут несколько шардов
+    template <typename T>
+    void refereeAdd(std::atomic<T>& counter, uint64_t delta) {
+        if (sharedReferee) {
+            counter.fetch_add(static_cast<T>(delta), std::memory_order_relaxed);
+        } else {
+            bump(counter, delta);
+        }
+    }
+
+    StatsSegment* segment = nullptr;
+    pid_t owner = 0;
+    std::string name;
+    size_t size = 0;
+    bool sharedReferee = false;
+};
+
+inline TourStats& tourStats = *new TourStats;
+
+#endif
@@ -0,0 +1,204 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <csignal>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "tourstats.h"
+
+// Смотрит на идущий турнир, запущенный с --stats: ./tourtop PID. Сегмент метрик отображается
+// только на чтение, так что tourtop ничего не пишет в память турнира и не берет его блокировок -
+// судья и игроки не замечают наблюдателя. Раз в интервал печатаются скорости за интервал
+// и распределение ожидания игроков.
+
+int intervalMs = 1000;
+bool once = false;
+
+// снимок счетчиков, скорости считаются по разнице двух снимков
+struct Snapshot {
+    int64_t at_ns = 0;
+    uint64_t moves = 0;
+    uint64_t draws = 0;
+    uint64_t referee_wait_ns = 0;
+    uint64_t referee_waits = 0;
+    uint64_t player_moves = 0;
+    uint64_t player_wait_ns = 0;
+    std::vector<uint64_t> hist = std::vector<uint64_t>(STATS_BUCKETS);
+};
+
+Snapshot takeSnapshot(const StatsSegment* segment) {
+    Snapshot snap;
+    snap.at_ns = statsNow();
+    snap.moves = segment->moves.load(std::memory_order_relaxed);
+    snap.draws = segment->draws.load(std::memory_order_relaxed);
+    snap.referee_wait_ns = segment->referee_wait_ns.load(std::memory_order_relaxed);
+    snap.referee_waits = segment->referee_waits.load(std::memory_order_relaxed);
+
+    const PlayerStats* players = segment->player_stats();
+    for (int i = 0; i < segment->players; i++) {
+        snap.player_moves += players[i].moves.load(std::memory_order_relaxed);
+        snap.player_wait_ns += players[i].wait_ns.load(std::memory_order_relaxed);
+        for (int b = 0; b < STATS_BUCKETS; b++) {
+            snap.hist[b] += players[i].wait_hist[b].load(std::memory_order_relaxed);
+        }
+    }
+    return snap;
+}
+
+// верхняя граница корзины, в которую попадает перцентиль p
+std::string percentile(const std::vector<uint64_t>& hist, double p) {
+    uint64_t total = 0;
+    for (uint64_t count : hist) {
+        total += count;
+    }
+    if (total == 0) {
+        return "-";
+    }
+
+    uint64_t seen = 0;
+    for (int b = 0; b < STATS_BUCKETS; b++) {
+        seen += hist[b];
+        if (seen >= p * total) {
+            if (b == STATS_BUCKETS - 1) {
+                return ">" + std::to_string((1ULL << (b + 9)) / 1000000) + " мс";
+            }
+            uint64_t bound = 1ULL << (b + 10);
+            return bound < 1000000 ? "<" + std::to_string(bound / 1000) + " мкс"
+                                   : "<" + std::to_string(bound / 1000000) + " мс";
+        }
+    }
+    return "-";
+}
+
+void print(const StatsSegment* segment, const Snapshot& prev, const Snapshot& cur, long pid) {
+    double seconds = (cur.at_ns - prev.at_ns) / 1e9;
+    double elapsed = (cur.at_ns - segment->start_ns) / 1e9;
+    int round = segment->round.load(std::memory_order_acquire);
+
+    std::cout << segment->variant << ", PID " << pid << ", игроков: " << segment->players
+              << ", прошло " << std::fixed << std::setprecision(1) << elapsed << " с" << std::endl;
+    if (segment->finished.load(std::memory_order_acquire)) {
+        std::cout << "Турнир закончен, выиграл игрок " << segment->winner.load() + 1 << std::endl;
+    } else {
+        std::cout << "Раунд " << round << std::endl;
+    }
+
+    std::cout << "Матчи по раундам:";
+    for (int r = 1; r <= round && r < STATS_MAX_ROUNDS; r++) {
+        std::cout << " " << segment->round_done[r].load(std::memory_order_relaxed) << "/"
+                  << segment->round_matches[r].load(std::memory_order_relaxed);
+    }
+    std::cout << std::endl;
+
+    uint64_t moves = cur.moves - prev.moves;
+    uint64_t draws = cur.draws - prev.draws;
+    std::cout << std::setprecision(0) << "Ходов: " << cur.moves << ", в секунду: " << moves / seconds
+              << ", ничьих за интервал: " << std::setprecision(1)
+              << (moves ? 200.0 * draws / moves : 0.0) << "%" << std::endl;
+
+    // доля времени, которую судья провел в ожидании хода, и среднее ожидание на ход
+    uint64_t refereeWaits = cur.referee_waits - prev.referee_waits;
+    uint64_t refereeWaitNs = cur.referee_wait_ns - prev.referee_wait_ns;
+    std::cout << "Судья ждет ходы " << 100.0 * refereeWaitNs / (seconds * 1e9) << "% времени, в среднем "
+              << (refereeWaits ? refereeWaitNs / refereeWaits / 1000.0 : 0.0) << " мкс на ход" << std::endl;
+
+    // распределение за интервал, а если ходов не было - за весь турнир
+    std::vector<uint64_t> hist(STATS_BUCKETS);
+    for (int b = 0; b < STATS_BUCKETS; b++) {
+        hist[b] = cur.hist[b] - prev.hist[b];
+    }
+    bool interval = cur.player_moves > prev.player_moves;
+    const std::vector<uint64_t>& shown = interval ? hist : cur.hist;
+    std::cout << "Ожидание игроков" << (interval ? " за интервал" : " за турнир") << ": p50 " << percentile(shown, 0.5)
+              << ", p90 " << percentile(shown, 0.9) << ", p99 " << percentile(shown, 0.99) << std::endl;
+
+    // игроки, которые дольше всех ждали запроса хода
+    const PlayerStats* players = segment->player_stats();
+    std::vector<std::pair<double, int>> slowest;
+    for (int i = 0; i < segment->players; i++) {
+        uint64_t count = players[i].moves.load(std::memory_order_relaxed);
+        if (count) {
+            slowest.push_back({players[i].wait_ns.load(std::memory_order_relaxed) / 1e3 / count, i});
+        }
+    }
+    size_t top = std::min<size_t>(5, slowest.size());
+    std::partial_sort(slowest.begin(), slowest.begin() + top, slowest.end(), std::greater<>());
+    std::cout << "Дольше всех ждут:";
+    for (size_t i = 0; i < top; i++) {
+        std::cout << " " << slowest[i].second + 1 << " (" << std::setprecision(0) << slowest[i].first << " мкс)";
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    long pid = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            intervalMs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--once") == 0) {
+            once = true;
+        } else {
+            pid = atol(argv[i]);
+        }
+    }
+
+    if (pid <= 0 || intervalMs <= 0) {
+        std::cerr << "Использование: ./tourtop PID [--interval MS] [--once]" << std::endl;
+        return 1;
+    }
+
+    std::string name = statsSegmentName(pid);
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd == -1) {
+        perror(("shm_open " + name + " (турнир запущен с --stats?)").c_str());
+        return 1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size < static_cast<off_t>(sizeof(StatsSegment))) {
+        std::cerr << "Сегмент " << name << " еще не готов" << std::endl;
+        return 1;
+    }
+    const StatsSegment* segment = static_cast<const StatsSegment*>(
+        mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0));
+    close(fd);
+    if (segment == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    if (segment->magic != STATS_MAGIC || st.st_size < static_cast<off_t>(statsSegmentSize(segment->players))) {
+        std::cerr << "Сегмент " << name << " не похож на метрики турнира" << std::endl;
+        return 1;
+    }
+
+    // в терминале экран перерисовывается, в файл или pipe снимки идут друг за другом
+    bool redraw = isatty(STDOUT_FILENO) && !once;
+    Snapshot prev = takeSnapshot(segment);
+    while (true) {
+        usleep(intervalMs * 1000);
+        Snapshot cur = takeSnapshot(segment);
+
+        if (redraw) {
+            std::cout << "\033[H\033[2J";
+        }
+        print(segment, prev, cur, pid);
+        if (!redraw) {
+            std::cout << std::endl;
+        }
+        prev = cur;
+
+        // турнир закончился или главный процесс исчез, не успев отметить конец
+        if (once || segment->finished.load(std::memory_order_acquire) || (kill(pid, 0) == -1 && errno == ESRCH)) {
+            break;
+        }
+    }
+    return 0;
+}
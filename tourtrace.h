@@ -0,0 +1,325 @@
+#ifndef TOURTRACE_H
+#define TOURTRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// Трасса турнира в формате Chrome trace (открывается в chrome://tracing и ui.perfetto.dev),
+// общая для всех вариантов. С флагом --trace FILE главный процесс до fork выделяет общую
+// память с буфером на каждый процесс: судья - буфер 0, игрок или воркер i - буфер i + 1.
+// Процесс пишет только в свой буфер, событие - это отметка CLOCK_MONOTONIC, тип и номер
+// игрока. При выходе главный процесс, дождавшись детей, склеивает буферы в JSON:
+//   у судьи  - раунды, "ожидание хода" и "обработка" между ходами, запросы, решения, ничьи
+//   у игрока - "ожидание запроса", "ход" от пробуждения до отправки хода и ожидание мьютекса
+// Запрос судьи связан стрелкой с пробуждением игрока, а ход игрока - с пробуждением судьи,
+// так что в интерфейсе видно, сколько уходит на пробуждение планировщиком, а сколько на мьютекс.
+// С --threads игроки - потоки главного процесса, буфер выбирается для потока, а в JSON
+// каждый поток игрока получает свой pid (номер потока в ядре), как отдельный процесс.
+
+enum TraceEventType : int16_t {
+    TRACE_ROUND_BEGIN,   // судья: начало раунда, arg - номер раунда
+    TRACE_ROUND_END,
+    TRACE_REQUEST,       // судья попросил ход у игрока arg (post семафора, сообщение, futex)
+    TRACE_REFEREE_WAIT,  // судья начал ждать ход
+    TRACE_REFEREE_WAKE,  // судья получил ход игрока arg
+    TRACE_DECIDE,        // судья определил победителя arg
+    TRACE_DRAW,          // ничья в матче игрока arg, матч переигрывается
+    TRACE_WAIT,          // игрок или воркер начал ждать запрос
+    TRACE_WAKE,          // запрос хода для игрока arg получен
+    TRACE_MOVE,          // ход игрока arg отправлен судье
+    TRACE_LOCK,          // начало ожидания мьютекса (main_sem, SEM_MAIN)
+    TRACE_LOCKED,
+};
+
+struct TraceRecord {
+    int64_t ts;
+    int32_t arg;
+    int16_t type;
+    int16_t thread;      // дорожка судьи (traceThread); у игроков всегда 0
+};
+
+enum TraceRole { TRACE_REFEREE, TRACE_PLAYER, TRACE_WORKER };
+
+struct alignas(64) TraceBuffer {
+    std::atomic<uint32_t> count;  // шарды судьи пишут в один буфер, поэтому место берется fetch_add
+    int32_t pid;
+    int32_t role;
+    int32_t number;
+    uint32_t capacity;
+    size_t first;                 // номер первой записи буфера в общем массиве
+};
+
+// дорожка судьи, на которую пишет поток: 0 - основной поток, k - шард k - 1
+inline thread_local int16_t traceThread = 0;
+
+class TourTrace {
+public:
+    // выделяет буферы для судьи и processes дочерних процессов; вызывается до fork
+    bool create(int processes, const char* file) {
+        path = file;
+        owner = getpid();
+        buffers = processes + 1;
+
+        // судье отдается больше всего места, остальное делится между процессами
+        uint32_t refereeCapacity = 1 << 20;
+        uint32_t processCapacity = std::max(256, std::min(1 << 16, (3 << 20) / processes));
+        size_t records = refereeCapacity + static_cast<size_t>(processCapacity) * processes;
+        size = buffers * sizeof(TraceBuffer) + records * sizeof(TraceRecord);
+
+        // страницы выделяются по мере записи, поэтому большой запас почти ничего не стоит
+        void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mem == MAP_FAILED) {
+            perror("mmap (trace)");
+            return false;
+        }
+        table = static_cast<TraceBuffer*>(mem);
+        records_ = reinterpret_cast<TraceRecord*>(table + buffers);
+
+        size_t first = 0;
+        for (int i = 0; i < buffers; i++) {
+            table[i].capacity = i == 0 ? refereeCapacity : processCapacity;
+            table[i].first = first;
+            first += table[i].capacity;
+        }
+
+        start = now();
+        attach(0, TRACE_REFEREE, 0);
+
+        static TourTrace* self;
+        self = this;
+        atexit([] { self->write(); });
+        return true;
+    }
+
+    // дочерний процесс или поток выбирает свой буфер в начале playerProcess / workerProcess.
+    // Для основного потока процесса номер потока в ядре совпадает с pid
+    void attach(int slot, TraceRole role, int number) {
+        if (!table) {
+            return;
+        }
+        current = &table[slot];
+        current->pid = syscall(SYS_gettid);
+        current->role = role;
+        current->number = number;
+    }
+
+    void event(TraceEventType type, int arg = -1) {
+        if (!table) {
+            return;
+        }
+        // потоки, не выбравшие буфер (шарды судьи), пишут в буфер судьи
+        TraceBuffer* buffer = current ? current : table;
+        // раунды всегда на основной дорожке: с --dataflow раунд может закрыть любой шард
+        int16_t thread = type == TRACE_ROUND_BEGIN || type == TRACE_ROUND_END ? 0 : traceThread;
+        uint32_t idx = buffer->count.fetch_add(1, std::memory_order_relaxed);
+        if (idx < buffer->capacity) {
+            records_[buffer->first + idx] = {now(), arg, type, thread};
+        }
+    }
+
+private:
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // склеивает буферы в JSON. Вызывается через atexit в главном процессе, когда дочерние уже завершены
+    void write() {
+        if (!table || getpid() != owner) {
+            return;
+        }
+
+        FILE* out = fopen(path.c_str(), "w");
+        if (!out) {
+            perror(path.c_str());
+            return;
+        }
+
+        // k-й запрос судьи игроку p связывается с k-м пробуждением по запросу для p,
+        // k-й ход игрока p - с k-м пробуждением судьи на ходе p
+        std::vector<uint32_t> requests, wakes, moves, refereeWakes;
+        size_t events = 0;
+        size_t dropped = 0;
+        bool first = true;
+        double end = (now() - start) / 1000.0;
+
+        fprintf(out, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+        for (int b = 0; b < buffers; b++) {
+            TraceBuffer& buffer = table[b];
+            if (buffer.pid == 0) {
+                continue;
+            }
+            uint32_t count = buffer.count.load();
+            dropped += count > buffer.capacity ? count - buffer.capacity : 0;
+            count = std::min(count, buffer.capacity);
+            events += count;
+
+            std::string name = buffer.role == TRACE_REFEREE ? "судья"
+                             : (buffer.role == TRACE_PLAYER ? "игрок " : "воркер ") + std::to_string(buffer.number);
+            emit(out, first, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"%s\"}}",
+                 buffer.pid, name.c_str());
+            emit(out, first, "{\"name\": \"process_sort_index\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"sort_index\": %d}}",
+                 buffer.pid, b);
+
+            // у каждого потока свое состояние: какие интервалы сейчас открыты. Воркер за одно
+            // пробуждение может обслужить несколько игроков, поэтому ожидание закрывается один раз
+            struct ThreadState {
+                bool processing = false;
+                bool waiting = false;
+            };
+            std::vector<ThreadState> threads;
+            const TraceRecord* records = records_ + buffer.first;
+            for (uint32_t i = 0; i < count; i++) {
+                const TraceRecord& r = records[i];
+                int pid = buffer.pid;
+                int tid = r.thread;
+                double ts = (r.ts - start) / 1000.0;
+                if (static_cast<size_t>(tid) >= threads.size()) {
+                    threads.resize(tid + 1);
+                    std::string thread = b == 0 && tid > 0 ? "шард " + std::to_string(tid) : name;
+                    emit(out, first, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+                         pid, tid, thread.c_str());
+                }
+                ThreadState& state = threads[tid];
+                auto closeProcessing = [&](int thread) {
+                    if (threads[thread].processing) {
+                        slice(out, first, "E", "обработка", pid, thread, ts);
+                        threads[thread].processing = false;
+                    }
+                };
+
+                switch (r.type) {
+                case TRACE_ROUND_BEGIN:
+                    emit(out, first, "{\"name\": \"раунд %d\", \"ph\": \"B\", \"pid\": %d, \"tid\": %d, \"ts\": %.3f}",
+                         r.arg, pid, tid, ts);
+                    break;
+                case TRACE_ROUND_END:
+                    // шарды к концу раунда уже завершились, их интервалы закрываются вместе с раундом
+                    for (size_t thread = 0; thread < threads.size(); thread++) {
+                        closeProcessing(thread);
+                    }
+                    slice(out, first, "E", "раунд", pid, tid, ts);
+                    break;
+                case TRACE_REQUEST:
+                    instant(out, first, "запрос хода", pid, tid, ts, r.arg);
+                    flow(out, first, "s", "запрос", pid, tid, ts, r.arg, counter(requests, r.arg), 0);
+                    break;
+                case TRACE_REFEREE_WAIT:
+                    closeProcessing(tid);
+                    slice(out, first, "B", "ожидание хода", pid, tid, ts);
+                    break;
+                case TRACE_REFEREE_WAKE:
+                    slice(out, first, "E", "ожидание хода", pid, tid, ts);
+                    slice(out, first, "B", "обработка", pid, tid, ts);
+                    state.processing = true;
+                    flow(out, first, "f", "ход", pid, tid, ts, r.arg, counter(refereeWakes, r.arg), 1);
+                    break;
+                case TRACE_DECIDE:
+                    instant(out, first, "победа", pid, tid, ts, r.arg);
+                    break;
+                case TRACE_DRAW:
+                    instant(out, first, "ничья, переигровка", pid, tid, ts, r.arg);
+                    break;
+                case TRACE_WAIT:
+                    slice(out, first, "B", "ожидание запроса", pid, tid, ts);
+                    state.waiting = true;
+                    break;
+                case TRACE_WAKE:
+                    if (state.waiting) {
+                        slice(out, first, "E", "ожидание запроса", pid, tid, ts);
+                        state.waiting = false;
+                    }
+                    emit(out, first, "{\"name\": \"ход\", \"ph\": \"B\", \"pid\": %d, \"tid\": %d, \"ts\": %.3f, \"args\": {\"player\": %d}}",
+                         pid, tid, ts, r.arg + 1);
+                    flow(out, first, "f", "запрос", pid, tid, ts, r.arg, counter(wakes, r.arg), 0);
+                    break;
+                case TRACE_MOVE:
+                    // начало стрелки должно лежать внутри интервала "ход", поэтому чуть раньше его конца
+                    flow(out, first, "s", "ход", pid, tid, ts - 0.001, r.arg, counter(moves, r.arg), 1);
+                    slice(out, first, "E", "ход", pid, tid, ts);
+                    break;
+                case TRACE_LOCK:
+                    slice(out, first, "B", "мьютекс", pid, tid, ts);
+                    break;
+                case TRACE_LOCKED:
+                    slice(out, first, "E", "мьютекс", pid, tid, ts);
+                    break;
+                }
+            }
+
+            // последнее ожидание игрока прерывается завершением турнира
+            for (size_t tid = 0; tid < threads.size(); tid++) {
+                if (threads[tid].waiting) {
+                    slice(out, first, "E", "ожидание запроса", buffer.pid, tid, end);
+                }
+            }
+        }
+        fprintf(out, "\n]}\n");
+        fclose(out);
+
+        printf("Трасса записана в %s, событий: %zu", path.c_str(), events);
+        if (dropped) {
+            printf(", не поместилось в буферы: %zu", dropped);
+        }
+        printf("\n");
+        munmap(table, size);
+        table = nullptr;
+        current = nullptr;
+    }
+
+    template <typename... Args>
+    static void emit(FILE* out, bool& first, const char* format, Args... args) {
+        fputs(first ? "" : ",\n", out);
+        fprintf(out, format, args...);
+        first = false;
+    }
+
+    static void slice(FILE* out, bool& first, const char* phase, const char* name, int pid, int tid, double ts) {
+        emit(out, first, "{\"name\": \"%s\", \"ph\": \"%s\", \"pid\": %d, \"tid\": %d, \"ts\": %.3f}", name, phase, pid, tid, ts);
+    }
+
+    static void instant(FILE* out, bool& first, const char* name, int pid, int tid, double ts, int player) {
+        emit(out, first, "{\"name\": \"%s\", \"ph\": \"i\", \"s\": \"t\", \"pid\": %d, \"tid\": %d, \"ts\": %.3f, \"args\": {\"player\": %d}}",
+             name, pid, tid, ts, player + 1);
+    }
+
+    static void flow(FILE* out, bool& first, const char* phase, const char* name, int pid, int tid, double ts,
+                     int player, uint32_t k, int kind) {
+        unsigned long long id = (static_cast<unsigned long long>(kind) << 62) | (static_cast<unsigned long long>(player) << 32) | k;
+        emit(out, first, "{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"%s\", \"id\": %llu, \"pid\": %d, \"tid\": %d, \"ts\": %.3f%s}",
+             name, name, phase, id, pid, tid, ts, phase[0] == 'f' ? ", \"bp\": \"e\"" : "");
+    }
+
+    // номер очередного события игрока player этого вида
+    static uint32_t counter(std::vector<uint32_t>& counts, int player) {
+        if (player < 0) {
+            return 0;
+        }
+        if (static_cast<size_t>(player) >= counts.size()) {
+            counts.resize(player + 1);
+        }
+        return counts[player]++;
+    }
+
+    TraceBuffer* table = nullptr;
+    TraceRecord* records_ = nullptr;
+    static inline thread_local TraceBuffer* current = nullptr; // буфер потока, после fork наследуется
+    int buffers = 0;
+    size_t size = 0;
+    int64_t start = 0;
+    pid_t owner = 0;
+    std::string path;
+};
+
+inline TourTrace& tourTrace = *new TourTrace;
+
+#endif